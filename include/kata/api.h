@@ -1,6 +1,4 @@
 /* kata/api.h - Kata's C API standard, which defines the stable interface to Kata
- *
- * TODO: introduce a 'kio_bufio' for buffered IO primitives?
  *
  * @author: Cade Brown <me@cade.site>
  */
@@ -62,6 +60,31 @@
 // Kata API function decorator
 #define KATA_API extern
 
+// thread-local storage decorator
+#define KATA_TLS _Thread_local
+
+// whether to keep memory statistics (see 'kmem_stats' and 'kmem_stats_type')
+// NOTE: build with '-DKATA_MEM_STATS=0' to compile them out entirely
+#ifndef KATA_MEM_STATS
+  #define KATA_MEM_STATS 1
+#endif
+
+// range of integers which are preallocated (and immortal), so making them is free
+// NOTE: build with '-DKATA_INT_CACHE_MAX=-1 -DKATA_INT_CACHE_MIN=0' to disable the cache
+#ifndef KATA_INT_CACHE_MIN
+  #define KATA_INT_CACHE_MIN (-256)
+#endif
+#ifndef KATA_INT_CACHE_MAX
+  #define KATA_INT_CACHE_MAX 4096
+#endif
+
+// whether to store small integers in tagged pointers, so they don't need an object at all
+// NOTE: when enabled, a 'kobj' with the low bit set is an integer (see 'KOBJ_ISTAG'), so code
+//         must use 'KOBJ_TYPE' (and 'KINT_*' for integers) instead of looking inside objects
+#ifndef KATA_TAGGED
+  #define KATA_TAGGED 0
+#endif
+
 
 // libbf library, for 'bf_t' and arbitrary precision math
 #include <kata/libbf.h>
@@ -163,8 +186,16 @@ typedef void*          kobj;
 // NOTE: should be same as sizeof(ktype) == sizeof(usize)
 #define KOBJ_EXTRA sizeof(struct kobj_meta)
 
+// macro to check whether an object is a tagged pointer (see 'KATA_TAGGED'), instead of
+//   a pointer to a real object
+#if KATA_TAGGED
+  #define KOBJ_ISTAG(_obj_) (((uintptr_t)(_obj_) & 1) != 0)
+#else
+  #define KOBJ_ISTAG(_obj_) false
+#endif
+
 // macro to retrieve the type of a Kata object
-#define KOBJ_TYPE(_obj_) KOBJ_META(_obj_)->type
+#define KOBJ_TYPE(_obj_) (KOBJ_ISTAG(_obj_) ? Kint : KOBJ_META(_obj_)->type)
 
 // macro to retrieve the reference count of a Kata object as an lval
 // NOTE: this should really only be used internally
@@ -172,12 +203,22 @@ typedef void*          kobj;
 // TODO: what to do if building without ARC/refcounting?
 #define KOBJ_REFC(_obj_) KOBJ_META(_obj_)->refc
 
+// bit of the reference count which marks an object as immortal (see 'kobj_immortal')
+// NOTE: immortal objects are never freed, and the reference counting macros skip them, so
+//         shared objects (types, constants, etc) don't get written to by every thread
+#define KOBJ_IMMORTAL ((usize)1 << (8 * sizeof(usize) - 1))
+
+// macro to check whether an object is immortal
+// NOTE: tagged pointers are always immortal
+#define KOBJ_ISIMMORTAL(obj_) (KOBJ_ISTAG(obj_) || (KOBJ_REFC(obj_) & KOBJ_IMMORTAL) != 0)
+
 // helper macro to get a new reference to an object (useful for readability)
 #define KOBJ_NEWREF(obj_) (kobj_newref((kobj)(obj_)))
 
 // increment reference count
 #define KOBJ_INCREF(obj_) do { \
-    KOBJ_REFC(obj_)++; \
+    kobj iobj__ = (kobj)(obj_); \
+    if (!KOBJ_ISIMMORTAL(iobj__)) KOBJ_REFC(iobj__)++; \
 } while(0)
 
 #define KOBJ_NINCREF(obj_) do { \
@@ -188,7 +229,7 @@ typedef void*          kobj;
 // decrement reference count
 #define KOBJ_DECREF(obj_) do { \
     kobj obj__ = (kobj)(obj_); \
-    if (!--KOBJ_REFC(obj__)) { \
+    if (!KOBJ_ISIMMORTAL(obj__) && !--KOBJ_REFC(obj__)) { \
         kobj_free(obj__); \
     }; \
 } while(0)
@@ -199,11 +240,37 @@ typedef void*          kobj;
 
 
 
+// range of integers which can be stored in tagged pointers
+#define KINT_TAG_MIN (INTPTR_MIN >> 1)
+#define KINT_TAG_MAX (INTPTR_MAX >> 1)
+
+// convert between an integer (within 'KINT_TAG_MIN' to 'KINT_TAG_MAX') and a tagged pointer
+// NOTE: only valid when 'KATA_TAGGED' is enabled
+#define KINT_TAG(val_) ((kobj)(((uintptr_t)(intptr_t)(val_) << 1) | 1))
+#define KINT_UNTAG(obj_) ((s64)((intptr_t)(obj_) >> 1))
+
+// macro to check whether an integer's value fits in an 's64' (i.e. it is tagged, or
+//   stored in 'small'), and to get that value
+#define KINT_ISSMALL(obj_) (KOBJ_ISTAG(obj_) || !((kint)(obj_))->isbig)
+#define KINT_SMALL(obj_) (KOBJ_ISTAG(obj_) ? KINT_UNTAG(obj_) : ((kint)(obj_))->small)
+
 // Kata integer, which is an arbitrary precision whole number
+// NOTE: values which fit in an 's64' are stored directly in 'small', and only larger
+//         values use libbf (so most integer math never allocates or calls libbf)
 typedef struct kint {
 
-    // numeric data, via libbf
-    bf_t val;
+    // whether the value is stored in 'val', instead of 'small'
+    bool isbig;
+
+    union {
+
+        // the value, if '!isbig'
+        s64 small;
+
+        // numeric data, via libbf, if 'isbig'
+        bf_t val;
+
+    };
 
 }* kint;
 
@@ -249,17 +316,41 @@ typedef struct kbytes {
 typedef struct kstr {
 
     // length in bytes and characters
+    // NOTE: the string is all ASCII if they are equal (see 'KSTR_ISASCII')
     usize lenb, lenc;
 
-    // hash of the string, according to 'kmem_hash(lenb, data)'
+    // hash of the string, according to 'kmem_hash(lenb, data)', or 0 if it hasn't been
+    //   calculated yet (see 'kstr_hash')
+    // NOTE: this may be set by any thread, so read it with 'kstr_hash'
     usize hash;
 
-    // UTF-8 encoded data, with NUL-terminator, stored
-    //   as part of the string
-    u8 data[0];
+    // UTF-8 encoded data, with NUL-terminator, or NULL if the string is a rope (i.e. a lazy
+    //   concatenation) which hasn't been flattened yet (see 'KSTR_DATA')
+    // NOTE: this is normally stored as part of the string, right after the structure, and
+    //         once set it never changes (except while building the string)
+    u8* data;
+
+    // the object which owns 'data', if the string is a view of it (see 'kstr_view'), or NULL
+    kobj src;
+
+    // whether the string is still being built (see 'kstr_builder'), which is the only time it
+    //   may be written to with 'kwrite'
+    bool builder;
+
+    // whether the string holds references to the children of a rope
+    // NOTE: a rope keeps them after it is flattened, since other threads may still be reading
+    //         them, until it is freed (or built in place, see 'kstr_reserve')
+    bool rope;
 
 }* kstr;
 
+// get the data of a string, flattening it first if it is a rope
+// NOTE: the acquire pairs with the flattening in another thread (see 'kstr_flat')
+#define KSTR_DATA(obj_) (__atomic_load_n(&(obj_)->data, __ATOMIC_ACQUIRE) ?: kstr_flat(obj_))
+
+// check whether a string is all ASCII, in which case bytes and characters are the same
+#define KSTR_ISASCII(obj_) ((obj_)->lenb == (obj_)->lenc)
+
 // Kata tuple, which is basically an immutable array
 typedef struct ktuple {
     
@@ -284,6 +375,14 @@ typedef struct kbuffer {
     // byte data of the buffer
     u8* data;
 
+    // whether the buffer is a ring (see 'kbuffer_ring'), in which case 'data[:cap]' is used
+    //   circularly: 'len' bytes are queued starting at 'pos' (the read cursor), and more are
+    //   written at '(pos + len) % cap' (the write cursor)
+    bool ring;
+
+    // whether an async IO request is transferring to or from the buffer (see 'kos_aio_submit')
+    bool aio;
+
 }* kbuffer;
 
 
@@ -397,6 +496,10 @@ kint_newf(f64 val);
 KATA_API kint
 kint_newz(bf_t* val);
 
+// get the value of an integer as a libbf value, which must be freed with 'kbf_done'
+KATA_API bool
+kint_getbf(kint obj, bf_t* out);
+
 
 // make a new float with the given value
 // NOTE: give 'prec=-1' to use whatever precision is neccessary to represent 'val'
@@ -423,15 +526,79 @@ kfloat_newz(bf_t* val);
 #define KFLOAT_PREC_INF   (-1)
 
 
-// make a new str (or return an interned one)
+// make a new str
 // NOTE: pass 'lenb=-1' to indicate that the string is NUL-terminated
 KATA_API kstr
 kstr_new(ssize lenb, const char* data);
 
+// get the interned string equal to 'data', making it if needed, so that equal interned strings
+//   are always the same object (and can be compared by pointer)
+// NOTE: pass 'lenb=-1' to indicate that the string is NUL-terminated
+// NOTE: interned strings are immortal, and are never removed from the table, so interning
+//         untrusted or generated data (i.e. every name the parser sees) uses memory without
+//         bound. all threads also share one table behind a lock
+KATA_API kstr
+kstr_intern(ssize lenb, const char* data);
+
+// get the interned string equal to 'obj', absorbing the reference to 'obj'
+KATA_API kstr
+kstr_internz(kstr obj);
+
+// make a string which is a view of the data of another object (i.e. without copying it), and
+//   holds a reference to that object, or NULL (and throws) if it is not valid UTF-8
+// NOTE: 'data' must be NUL-terminated, and stay valid and unchanged while 'src' is alive
+KATA_API kstr
+kstr_view(kobj src, usize lenb, const u8* data);
+
+// make a new (empty) string to be built in place, with room for at least 'cap' bytes
+// write to it with 'kstr_reserve' and 'kstr_commit' (or use it as the target of 'kwrite'), and
+//   then call 'kstr_seal' before using it as a string (after which 'kwrite' fails)
+KATA_API kstr
+kstr_builder(usize cap);
+
+// get a pointer to room for at least 'len' more bytes at the end of a string, growing it if
+//   needed, or NULL if it could not be grown
+// NOTE: there must be no other references to the string
+KATA_API u8*
+kstr_reserve(kstr obj, usize len);
+
+// mark 'len' more bytes as written at the end of a string (after 'kstr_reserve')
+KATA_API void
+kstr_commit(kstr obj, usize len);
+
+// finish building a string, absorbing the reference to it, which validates the data (and
+//   counts the characters) and calculates the hash
+// NOTE: returns NULL (and throws) if the data is not valid UTF-8
+KATA_API kstr
+kstr_seal(kstr obj);
+
+// get 'a + b', which is made as a rope (so that it is only copied when the data is needed)
+//   unless it is short
+KATA_API kstr
+kstr_concat(kstr a, kstr b);
+
+// get 'a + b', absorbing the reference to 'a', which appends to 'a' in place if there are no
+//   other references to it (so building a string with repeated calls takes linear time)
+KATA_API kstr
+kstr_concatz(kstr a, kstr b);
+
+// flatten a rope, so its data is contiguous, and return the data
+// NOTE: use 'KSTR_DATA()' instead, which only calls this for ropes
+KATA_API u8*
+kstr_flat(kstr obj);
+
+// get the hash of a string, calculating it if needed
+KATA_API usize
+kstr_hash(kstr obj);
+
 // create a string from a C-style varargs, see kprintf()
 KATA_API kstr
 kstr_fmt(const char* fmt, ...);
 
+// check whether 'data' is valid UTF-8, and if so, set '*lenc' to the number of characters
+KATA_API bool
+kstr_utf8(usize lenb, const u8* data, usize* lenc);
+
 // compare 'a' and 'b', returning:
 //   <0: when a<b
 //  ==0: when a==b
@@ -467,10 +634,40 @@ kbuffer_push(struct kbuffer* obj, usize len, const u8* data);
 KATA_API keno
 kbuffer_pop(struct kbuffer* obj, usize len);
 
+// turn a buffer into a ring with a fixed capacity, which can be used as a bounded queue of
+//   bytes between a producer and a consumer (the unread bytes, 'data[pos:len]', are kept)
+// NOTE: reads and writes never move data, and writes only do what fits (like a pipe)
+KATA_API keno
+kbuffer_ring(struct kbuffer* obj, usize cap);
+
+// get a span to write directly into at the end of a buffer, setting '*len' to its length,
+//   which is then added to the buffer with 'kbuffer_commit'
+// NOTE: for rings, the span is what fits contiguously (which may be less than '*len', or 0
+//         if it is full). otherwise, the buffer grows to fit at least '*len' bytes
+KATA_API u8*
+kbuffer_reserve(struct kbuffer* obj, usize* len);
+
+// add 'len' bytes written into the span from 'kbuffer_reserve'
+KATA_API void
+kbuffer_commit(struct kbuffer* obj, usize len);
+
+// get a span of unread data (starting at 'pos'), setting '*len' to its length, which can be
+//   marked as read with 'kbuffer_consume'
+// NOTE: for rings, this is only up to the end of the data (there may be more at the start)
+KATA_API const u8*
+kbuffer_peek(struct kbuffer* obj, usize* len);
+
+// mark 'len' bytes as read, from the span from 'kbuffer_peek'
+// NOTE: for rings, this also frees the space for writing
+KATA_API void
+kbuffer_consume(struct kbuffer* obj, usize len);
+
 // return a string of the buffer contents
+// NOTE: for rings, this is the unread data
 KATA_API kstr
 kbuffer_str(struct kbuffer* obj);
 // return a string of the buffer contents, and decref it (useful in some locations)
+// NOTE: if that was the last reference, the string takes the buffer's data without copying
 KATA_API kstr
 kbuffer_strz(kbuffer obj);
 
@@ -621,9 +818,17 @@ typedef struct kfunc {
 KATA_API kobj
 kfunc_new(kcfunc cfunc, const char* name, const char* docs);
 
+// C slot signatures, for the 'c_*' members of 'ktype'
+typedef void (*kslot_del)(kobj obj);
+typedef ssize (*kslot_repr)(kobj io, kobj obj);
+typedef bool (*kslot_hash)(kobj obj, usize* res);
+typedef bool (*kslot_eq)(kobj a, kobj b, bool* res);
+typedef kobj (*kslot_binop)(kobj a, kobj b);
+typedef kobj (*kslot_call)(kobj fn, usize nargs, kobj* vargs);
+
 // Kata type, which is like a type/class/struct in other languages, it defines
 //   a datatype and associated functions/attributes/methods for that type
-// TODO: differentiate 
+// TODO: differentiate
 typedef struct ktype {
 
     /// Type Attributes ///
@@ -643,6 +848,10 @@ typedef struct ktype {
     // the position of the 'bf_t' within the structure, or <0 if there is none
     s32 bfpos;
 
+    // small integer identifying the type, which indexes the operator dispatch table (see
+    //   'kop_register'), or 0 if the type has none
+    s32 id;
+
     // popular type traits, for efficiency are stored with the type
     bool is_int, is_float;
 
@@ -690,11 +899,46 @@ typedef struct ktype {
     //   function that adds 'repr(obj)' to 'io', and returns the number of bytes read
     kobj fn_repr;
 
+    /// C Slots ///
+    //
+    // C functions which implement common operations directly, without going through
+    //   'kcall' (and parsing arguments with 'kargs'). these are checked first, and if
+    //   they are NULL, the script-visible functions above (i.e. '__del', '__repr') are
+    //   used instead
+    //
+    // for binary operators, the slot of the left operand's type is used, and it should
+    //   handle any type of right operand (or throw an error)
+    //
+
+    // deletes the object itself and any resources used (like '__del')
+    kslot_del c_del;
+
+    // adds 'repr(obj)' to 'io', and returns the number of bytes written (like '__repr')
+    kslot_repr c_repr;
+
+    // calculates 'hash(obj)', and 'a == b' (see 'kobj_hash' and 'kobj_eq')
+    // NOTE: objects which are equal must have the same hash
+    kslot_hash c_hash;
+    kslot_eq c_eq;
+
+    // operators (see 'kop_*')
+    kslot_binop c_add, c_mul, c_div, c_fdiv, c_pow;
+
+    // calls the object (see 'kcall')
+    kslot_call c_call;
+
+    /// Statistics ///
+
+    // index of the type in the per-thread statistics of live objects (see 'kmem_stats_type')
+    // NOTE: unlike 'id', this is never shared with another type
+    s32 st_idx;
+
 }* ktype;
 
-// helper macro to declare a statically allocated type
-#define KTYPE_DECL(name_) static u8 name_##_[sizeof(struct kobj_meta) + sizeof(struct ktype)]; \
-    ktype name_ = (ktype)(name_##_ + sizeof(struct kobj_meta)); \
+// helper macro to declare a statically allocated type, which is immortal
+// NOTE: the meta's type is filled in by 'ktype_init'
+#define KTYPE_DECL(name_) static struct { struct kobj_meta meta; struct ktype tp; } name_##_ = { { NULL, KOBJ_IMMORTAL } }; \
+    ktype name_ = &name_##_.tp; \
 
 // initialize a type with the given information
 KATA_API void
@@ -808,6 +1052,11 @@ KATA_API kdict
 Kglobals
 ;
 
+// list of all types which have been initialized with 'ktype_init'
+KATA_API klist
+Ktypes
+;
+
 KATA_API ktype
 Kint,
 Kfloat,
@@ -822,7 +1071,9 @@ Kdict_entry,
 
 Kfunc,
 Ktype,
-Kthread
+Kthread,
+
+Kexc
 ;
 
 // special string constants
@@ -890,12 +1141,33 @@ KATA_API kobj
 kqcall(kobj fn, usize nargs, kobj* vargs);
 
 // utilitry macro for inside 'KCFUNC' definitions
+// NOTE: the format string is compiled once, the first time it is used (see 'kargs_spec')
 #define KARGS(fmt_, ...) do { \
-    if (!kargs(nargs, vargs, fmt_, __VA_ARGS__)) { \
+    static struct kargs_spec spec__; \
+    if (!kargs_spec(&spec__, nargs, vargs, fmt_, (void*[]){ __VA_ARGS__ })) { \
         kexit(-1); \
     } \
 } while (0)
 
+// maximum number of arguments in a compiled argument specification
+#define KARGS_MAX 32
+
+// compiled argument specification, which is a format string (see 'kargs') parsed ahead
+//   of time, so arguments can be checked without re-parsing it every call
+// NOTE: a zero-initialized spec is valid, and is compiled on first use
+struct kargs_spec {
+
+    // whether the spec has been compiled
+    bool ok;
+
+    // number of arguments
+    s32 nargs;
+
+    // bitmask of which arguments have a required type (i.e. 'name:!')
+    u32 typed;
+
+};
+
 
 // parse function arguments from a C-style format string
 // the general idea is to emulate what the VM would do, and allow similar functionality
@@ -909,6 +1181,16 @@ kargs(s32 nargs, kobj* vargs, const char* fmt, ...);
 KATA_API bool
 kargsv(s32 nargs, kobj* vargs, const char* fmt, va_list ap);
 
+// compile a format string (see 'kargs') into 'spec'
+KATA_API bool
+kargs_compile(struct kargs_spec* spec, const char* fmt);
+
+// parse function arguments with a compiled spec, compiling it from 'fmt' if it hasn't been yet
+// 'args' holds a pointer to each destination, which is followed by the required type for
+//   typed arguments (i.e. the same as the variadic arguments to 'kargs')
+KATA_API bool
+kargs_spec(struct kargs_spec* spec, s32 nargs, kobj* vargs, const char* fmt, void** args);
+
 // check whether 'obj is trait'
 KATA_API bool
 kis(kobj obj, kobj trait, bool* good);
@@ -924,14 +1206,55 @@ kread(kobj io, usize len, void* data);
 KATA_API ssize
 kwrite(kobj io, usize len, const void* data);
 
+// write a sequence of bytes to a IO-like object, like 'kwrite', but large writes may be
+//   referenced instead of copied (and sent later, in one system call with other writes)
+// NOTE: this only borrows 'data' in the outermost hold of 'io' (i.e. directly in 'kprintf'
+//         or 'kwriteR' on a buffered IO), in which case it must stay valid and unchanged
+//         until that call returns. otherwise, it is the same as 'kwrite'
+KATA_API ssize
+kwriteg(kobj io, usize len, const void* data);
+
+// flush any buffered writes to an IO object, returning 0 on success
+// NOTE: this does nothing for unbuffered IO objects
+KATA_API keno
+kflush(kobj io);
 
-// writing some primitive datatypes to an 'io'
+// copy up to 'len' bytes (or, if 'len<0', everything) from one IO object to another, in the
+//   kernel when both are file descriptors (so the data is never copied into user space)
+// NOTE: number of bytes moved returned (less than 'len' at the end of 'src'), or <0 on error
+//         if nothing was moved
 KATA_API ssize
-kwriteu(kobj io, u64 val, s8 base, s32 width);
+kcopy(kobj src, kobj dst, ssize len);
+
+
+// flags for formatting numbers (see 'kwriteu', 'kwrites' and 'kwritef'), like C's printf flags
+enum {
+    // no flags
+    KWRITE_NONE        = 0x00,
+
+    // pad with zeros (after the sign) instead of spaces, i.e. '%05i'
+    KWRITE_ZERO        = 0x01,
+
+    // pad on the right instead of the left, i.e. '%-5i'
+    KWRITE_LEFT        = 0x02,
+
+    // always give a sign, i.e. '%+i'
+    KWRITE_PLUS        = 0x04,
+
+    // give a space where a '+' would be, i.e. '% i'
+    KWRITE_SPACE       = 0x08,
+};
+
+// writing some primitive datatypes to an 'io', padded to at least 'width' characters
 KATA_API ssize
-kwrites(kobj io, s64 val, s8 base, s32 width);
+kwriteu(kobj io, u64 val, s8 base, s32 width, u32 flags);
 KATA_API ssize
-kwritef(kobj io, f64 val, s8 base, s32 width, s32 prec);
+kwrites(kobj io, s64 val, s8 base, s32 width, u32 flags);
+
+// write a float with 'prec' digits after the point, correctly rounded, or, if 'prec<0', the
+//   shortest digits which read back as the same value (i.e. '0.1', '1e+16')
+KATA_API ssize
+kwritef(kobj io, f64 val, s8 base, s32 width, s32 prec, u32 flags);
 
 // writing different serialization formats of 'obj' to 'io'
 // for example, %B, %S, %R
@@ -954,6 +1277,8 @@ kwriteR(kobj io, kobj obj);
 //   %R: kobj value, outputs 'repr(val)'
 //   %J: kobj iterable, outputs '", ".join(val | repr)'
 //   %Y: kobj?, outputs ", %R" % (val, ) or nothing if it is NULL
+// NOTE: numbers take C-style flags ('-', '+', ' ', '0'), width, and precision (which is the
+//         minimum number of digits for integers)
 KATA_API ssize
 kprintf(kobj io, const char* fmt, ...);
 KATA_API ssize
@@ -963,15 +1288,36 @@ kprintfv(kobj io, const char* fmt, va_list args);
 
 /// object API ///
 
+// forward declaration (see 'kata/mem.h')
+struct kmem_arena;
+
 // make an empty object, and initialize its meta for a given type
 // NOTE: the resulting object will be uninitialized (the metadata will be, though)
 KATA_API kobj
 kobj_make(ktype tp);
 
+// make an empty object with an explicit size (in bytes, not including the meta), which is
+//   useful for variable sized types (for example, 'kstr' and 'ktuple')
+// NOTE: the resulting object will be uninitialized (the metadata will be, though)
+KATA_API kobj
+kobj_makex(ktype tp, usize sz);
+
+// make an empty object with an explicit size, allocated from 'arena' (or like 'kobj_makex',
+//   if 'arena' is NULL)
+// NOTE: the memory is released along with the arena, so the object must not outlive it
+KATA_API kobj
+kobj_makea(struct kmem_arena* arena, ktype tp, usize sz);
+
 // return a new reference to 'obj'
 KATA_API kobj
 kobj_newref(kobj obj);
 
+// make 'obj' immortal, so it is never freed, and reference counting skips it
+// NOTE: this should only be used for objects which live until the program exits, and
+//         absorbs the reference given
+KATA_API void
+kobj_immortal(kobj obj);
+
 
 // free an object, according to its type constructor
 // NOTE: do not call this directly, use 'KOBJ_DECREF()' instead
@@ -1007,10 +1353,35 @@ kobj_eq(kobj a, kobj b, bool* out);
 KATA_API void*
 kcheck(kobj obj, ktype tp);
 
+// maximum number of type ids (see 'ktype.id'), types made after this many get id 0
+#define KTYPE_MAXID 32
+
+// binary operators, which index the operator dispatch table
+enum {
+    KOP_ADD = 0,
+    KOP_MUL,
+    KOP_DIV,
+    KOP_FDIV,
+    KOP_POW,
+
+    // number of binary operators
+    KOP_N
+};
+
+// register a kernel for binary operator 'op' (see 'KOP_*') with operands of type 'a' and 'b'
+// NOTE: operators first use registered kernels, then the left operand's C slot (i.e. 'c_add'),
+//         then its attribute (i.e. '__add'), and otherwise throw an error
+KATA_API bool
+kop_register(s32 op, ktype a, ktype b, kslot_binop fn);
+
 // compute 'a + b'
 KATA_API kobj
 kop_add(kobj a, kobj b);
 
+// compute 'a + b', absorbing the reference to 'a' (which may be updated in place)
+KATA_API kobj
+kop_addz(kobj a, kobj b);
+
 // compute 'a * b'
 KATA_API kobj
 kop_mul(kobj a, kobj b);
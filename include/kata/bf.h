@@ -33,6 +33,17 @@ kbf_const(kobj val, bf_t* obj, bool* dodone);
 KATA_API void
 kbf_done(bf_t* obj);
 
+// calculate the hash of a numeric value
+// NOTE: numbers which are equal have the same hash, regardless of type (i.e. 'hash(2) == hash(2.0)')
+KATA_API usize
+kbf_hashs(s64 val);
+KATA_API usize
+kbf_hash(const bf_t* val);
+
+// calculate whether two numeric objects are equal, or set '*res' to false if 'b' is not numeric
+KATA_API bool
+kbf_eq(kobj a, kobj b, bool* res);
+
 // internal allocation function for libbf
 KATA_API void*
 kbf_realloc(void *opaque, void *ptr, size_t sz);
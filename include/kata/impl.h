@@ -26,6 +26,8 @@ kinit_float();
 
 KATA_API void
 kinit_str();
+KATA_API void
+kinit_buffer();
 
 KATA_API void
 kinit_tuple();
@@ -41,6 +43,68 @@ kinit_func();
 KATA_API void
 kinit_exc();
 
+KATA_API void
+kinit_ops();
+
+// numeric operators (using libbf), which are the operator slots for 'int' and 'float'
+KATA_API kobj
+kop_add_bf(kobj a, kobj b);
+KATA_API kobj
+kop_mul_bf(kobj a, kobj b);
+KATA_API kobj
+kop_div_bf(kobj a, kobj b);
+KATA_API kobj
+kop_fdiv_bf(kobj a, kobj b);
+KATA_API kobj
+kop_pow_bf(kobj a, kobj b);
+
+// header stored before blocks which aren't from slabs or arenas, so their size is known
+// NOTE: this is 16 bytes, so blocks stay 16-byte aligned
+struct kmem_big {
+
+    // usable size of the block, in bytes
+    usize sz;
+
+    // size of the mapping the block is in (see 'kmem_huge_make'), or 0 if the
+    //   block is from the C library
+    usize map;
+
+};
+
+// memory statistics hooks, called with the usable size of blocks
+// NOTE: only called when 'KATA_MEM_STATS' is enabled
+KATA_API void
+kmem_stats_onmake(usize sz);
+KATA_API void
+kmem_stats_onfree(usize sz);
+
+// live object statistics hook, called with the change in objects of a type and their size
+// NOTE: only called when 'KATA_MEM_STATS' is enabled
+KATA_API void
+kmem_stats_onobj(ktype tp, s64 n, s64 sz);
+
+// powers of 5 (and their inverses) as 125-bit fixed point numbers, for shortest float
+//   formatting (see 'kwritef'), as {low, high} 64-bit halves
+KATA_API const u64 Kpow5[326][2];
+KATA_API const u64 Kpow5inv[342][2];
+
+// buffered IO, which 'kread', 'kwrite' (and 'kwriteg', which may borrow) and 'kflush' use
+//   for 'Kio_bufio' objects
+KATA_API ssize
+kio_bufio_read(kio_bufio obj, usize len, u8* data);
+KATA_API ssize
+kio_bufio_write(kio_bufio obj, usize len, const u8* data, bool borrow);
+KATA_API keno
+kio_bufio_flush(kio_bufio obj);
+
+// hold an IO object, so that 'kwriteg' may borrow data until it is released (which sends
+//   anything borrowed, once the outermost hold is released)
+// NOTE: these do nothing for objects which aren't buffered IO
+KATA_API void
+kio_hold(kobj io);
+KATA_API keno
+kio_release(kobj io);
+
 // module initializers
 KATA_API void
 kinit_mem();
@@ -48,6 +112,12 @@ KATA_API void
 kinit_os();
 KATA_API void
 kinit_os_rawio();
+KATA_API void
+kinit_os_bufio();
+KATA_API void
+kinit_os_mmap();
+KATA_API void
+kinit_os_aio();
 
 KATA_API void
 kinit_ks();
@@ -164,6 +164,10 @@ typedef struct ks_tok {
 KATA_API ks_tok
 ks_tok_new(s32 kind, s32 posb, s32 lenb, s32 line, s32 col, s32 lenc);
 
+// create a new token, allocated from 'arena' (or the heap, if 'arena' is NULL)
+KATA_API ks_tok
+ks_tok_newa(struct kmem_arena* arena, s32 kind, s32 posb, s32 lenb, s32 line, s32 col, s32 lenc);
+
 // describes the kind/type of an AST
 enum {
     
@@ -335,6 +339,15 @@ ks_ast_wrap(ks_tok tok, kobj sub);
 KATA_API ks_ast
 ks_ast_wrapx(ks_tok tok, u32 kind, kobj sub);
 
+// variants of the above, which allocate the node (and its tuple of sub nodes) from
+//   'arena' (or the heap, if 'arena' is NULL)
+// NOTE: arena nodes can still be decref'd as usual (which releases the references they
+//         hold), but they must not outlive the arena
+KATA_API ks_ast
+ks_ast_newza(struct kmem_arena* arena, ks_tok tok, u32 kind, int nsub, kobj* sub);
+KATA_API ks_ast
+ks_ast_wrapxa(struct kmem_arena* arena, ks_tok tok, u32 kind, kobj sub);
+
 // return a constant reference to a string for the given AST kind
 KATA_API const char*
 ks_ast_kindname(u32 kind);
@@ -351,10 +364,22 @@ ks_ast_kindname(u32 kind);
 KATA_API s32
 ks_lex(kstr filename, kstr src, ks_tok** ptoks);
 
+// like 'ks_lex', but allocates tokens from 'arena' (or the heap, if 'arena' is NULL)
+// NOTE: arena tokens don't need to be decref'd, they are freed with the arena
+KATA_API s32
+ks_lexa(kstr filename, kstr src, ks_tok** ptoks, struct kmem_arena* arena);
+
 // parse a KataScript file contents into an AST
 KATA_API ks_ast
 ks_parse(kstr filename, kstr src, s32* pntoks, ks_tok** ptoks);
 
+// like 'ks_parse', but allocates tokens and AST nodes from 'arena' (or the heap, if 'arena'
+//   is NULL), so that compiling a file only costs a few chunk allocations
+// NOTE: the result should still be decref'd before the arena is done, to release the
+//         constants (which are allocated normally) it references
+KATA_API ks_ast
+ks_parsea(kstr filename, kstr src, s32* pntoks, ks_tok** ptoks, struct kmem_arena* arena);
+
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -11,6 +11,87 @@
 #define KATA_MEM_H
 
 
+// size of a slab (and of a page map chunk), in bytes
+// NOTE: slabs are also aligned to this
+#define KMEM_SLAB_SZ   (64 * 1024)
+
+// maximum size of a block, in bytes, which is served by the slab allocator
+// NOTE: larger blocks are served by the C library
+#define KMEM_SLAB_MAX  1024
+
+// minimum size of a block, in bytes, which is mapped straight from the OS
+// NOTE: these can grow without copying, and are given back to the OS when freed
+#define KMEM_HUGE_MIN  (1024 * 1024)
+
+// kinds of chunks in the page map (see 'kmem_pmap_get')
+enum {
+    // not managed by kmem (i.e. C library memory, or unmapped)
+    KMEM_CHUNK_NONE    = 0,
+
+    // slab of small blocks (see 'kmem_slab_make')
+    KMEM_CHUNK_SLAB    = 1,
+
+    // chunk of an arena (see 'kmem_arena_make')
+    KMEM_CHUNK_ARENA   = 2,
+
+};
+
+// region/arena allocator, which makes blocks by bumping a pointer, and frees them
+//   all at once
+// NOTE: blocks from an arena may be passed to 'kmem_free' (which does nothing), but
+//         must not be passed to 'kmem_grow'
+struct kmem_arena {
+
+    // the newest chunk, which is the head of a list of all chunks
+    struct kmem_arena_chunk* chunk;
+
+    // the free region of the newest chunk
+    u8* cur;
+    u8* end;
+
+};
+
+// position within an arena, which can be reset to
+struct kmem_arena_mark {
+
+    // the newest chunk at the time of the mark
+    struct kmem_arena_chunk* chunk;
+
+    // the position within 'chunk'
+    u8* cur;
+
+};
+
+
+// memory statistics, as reported by 'kmem_stats'
+struct kmem_stats {
+
+    // number of blocks made and freed, over the lifetime of the program
+    u64 nmake, nfree;
+
+    // bytes made and freed, over the lifetime of the program
+    u64 bmake, bfree;
+
+    // bytes currently in use, and the peak bytes in use
+    // NOTE: the peak is only accurate to within 64KiB per thread
+    u64 cur, peak;
+
+};
+
+// streaming hasher state (see 'kmem_hasher_init')
+struct kmem_hasher {
+
+    // state of each lane
+    u64 s0, s1;
+
+    // total number of bytes added
+    u64 len;
+
+    // partial block, of 'len % 32' bytes
+    u8 buf[32];
+
+};
+
 // make a memory block of a given size
 // NOTE: only pass these to 'kmem_grow' or 'kmem_growx' or 'kmem_free'
 KATA_API void*
@@ -39,12 +120,115 @@ kmem_nextcap(usize cap, usize sz);
 KATA_API void
 kmem_free(void* ptr);
 
-// hash memory contents, according to to djb2 internal algorithm
-// TODO: have routine that fuses the length and hash operation,
-//         to only loop once?
+// make a small memory block (<= KMEM_SLAB_MAX bytes) from the slab allocator
+// NOTE: 'kmem_make' already does this for small sizes, so prefer that
+KATA_API void*
+kmem_slab_make(usize sz);
+
+// free a block allocated with 'kmem_slab_make'
+KATA_API void
+kmem_slab_free(void* ptr);
+
+// return the usable size of a block allocated with 'kmem_slab_make', in bytes
+KATA_API usize
+kmem_slab_sizeof(const void* ptr);
+
+// return whether 'ptr' was allocated with 'kmem_slab_make'
+KATA_API bool
+kmem_slab_has(const void* ptr);
+
+// make a huge memory block (>= KMEM_HUGE_MIN bytes) by mapping pages from the OS
+// NOTE: 'kmem_make' already does this for huge sizes, so prefer that
+KATA_API void*
+kmem_huge_make(usize sz);
+
+// grow a block made with 'kmem_huge_make', moving pages instead of copying if possible
+KATA_API bool
+kmem_huge_grow(void** pptr, usize sz);
+
+// free a block made with 'kmem_huge_make', giving its pages back to the OS
+KATA_API void
+kmem_huge_free(void* ptr);
+
+// push any blocks this thread freed on behalf of other threads back to them
+// NOTE: this happens automatically in batches, and when a thread exits, so this only needs
+//         to be called by threads which free lots of memory and then stay idle
+KATA_API void
+kmem_flush();
+
+// initialize an empty arena
+KATA_API void
+kmem_arena_init(struct kmem_arena* arena);
+
+// done with an arena, free all blocks made from it
+KATA_API void
+kmem_arena_done(struct kmem_arena* arena);
+
+// make a block of a given size from an arena
+KATA_API void*
+kmem_arena_make(struct kmem_arena* arena, usize sz);
+
+// get the current position of an arena
+KATA_API struct kmem_arena_mark
+kmem_arena_mark(struct kmem_arena* arena);
+
+// free all blocks made from an arena after 'mark' was taken
+KATA_API void
+kmem_arena_reset(struct kmem_arena* arena, struct kmem_arena_mark mark);
+
+// return the kind of the chunk 'ptr' is within (see 'KMEM_CHUNK_*')
+KATA_API u8
+kmem_pmap_get(const void* ptr);
+
+// set the kind of all chunks in a region, which must be aligned to KMEM_SLAB_SZ
+// NOTE: returns false if the region can't be represented in the page map
+KATA_API bool
+kmem_pmap_set(const void* ptr, usize sz, u8 kind);
+
+// return the usable size of a block made with 'kmem_make', in bytes (or 0 if unknown,
+//   which is the case for arena blocks)
+KATA_API usize
+kmem_sizeof(const void* ptr);
+
+// get the current memory statistics
+// NOTE: sizes include rounding to size classes, but not the cost of the allocator's
+//         own structures. if 'KATA_MEM_STATS' is disabled, everything is 0
+KATA_API void
+kmem_stats(struct kmem_stats* out);
+
+// get the number of live objects of a type, and the bytes they use (including their meta),
+//   summed over all threads
+// NOTE: objects made from arenas aren't counted. if 'KATA_MEM_STATS' is disabled, these are 0
+KATA_API void
+kmem_stats_type(ktype tp, usize* live, usize* live_sz);
+
+// get the current memory statistics as a dict, including per-type statistics
+KATA_API kdict
+kmem_stats_dict();
+
+// hash memory contents, with a fast 64-bit hash (see 'src/mem/hash.c')
 KATA_API usize
 kmem_hash(usize len, const u8* data);
 
+// hash a NUL-terminated string, and store its length in '*len' (if non-NULL)
+// NOTE: this is equivalent to 'kmem_hash(strlen(str), str)', but only loops once
+KATA_API usize
+kmem_hashz(const char* str, usize* len);
+
+// start hashing with a streaming hasher
+KATA_API void
+kmem_hasher_init(struct kmem_hasher* hs);
+
+// add bytes to a streaming hasher
+KATA_API void
+kmem_hasher_update(struct kmem_hasher* hs, usize len, const u8* data);
+
+// get the hash of all bytes added to a streaming hasher, which is the same
+//   as 'kmem_hash' on all of them concatenated
+// NOTE: this doesn't change the hasher, so more bytes may be added afterwards
+KATA_API usize
+kmem_hasher_final(struct kmem_hasher* hs);
+
 
 // return whether 'n' is prime
 KATA_API usize
@@ -8,6 +8,8 @@
 #ifndef KATA_OS_H
 #define KATA_OS_H
 
+#include <pthread.h>
+
 
 // OS's raw IO interface, through C-style libraries only currently
 typedef struct kos_rawio {
@@ -22,6 +24,210 @@ KATA_API kos_rawio
 kos_rawio_newd(s32 fd_);
 
 
+// hints for 'kos_mmap_new', about how the data will be used
+enum {
+    // no hints
+    KOS_MMAP_NONE      = 0x00,
+
+    // data will be read in order, so read ahead aggressively
+    KOS_MMAP_SEQ       = 0x01,
+    // data will be read soon, so start reading it in now
+    KOS_MMAP_WILLNEED  = 0x02,
+    // data will be read in random order, so don't read ahead
+    KOS_MMAP_RANDOM    = 0x04,
+
+};
+
+// read-only memory map of a file, which can be read like a buffer (with 'kread'), or viewed
+//   as a string without copying (with 'kstr_view')
+// NOTE: the data is always followed by a NUL-terminator
+typedef struct kos_mmap {
+
+    // the mapped data, and its length in bytes
+    const u8* data;
+    usize len;
+
+    // current position, in bytes, for reading
+    usize pos;
+
+    // size of the whole mapping, in bytes
+    usize mapsz;
+
+}* kos_mmap;
+
+// map a file into memory, read-only, with hints (see 'KOS_MMAP_*')
+// NOTE: returns NULL (and throws) if the file could not be mapped
+KATA_API kos_mmap
+kos_mmap_new(const char* path, u32 hints);
+
+
+// default buffer size for 'kio_bufio', in bytes
+#define KIO_BUFIO_CAP 8192
+
+// maximum number of pending segments for 'kio_bufio', which are sent together (with 'writev'
+//   for raw IO)
+#define KIO_BUFIO_NSEG 64
+
+// writes at least this large are referenced instead of copied, when allowed (see 'kwriteg')
+#define KIO_BUFIO_BORROW 256
+
+// buffered IO, which wraps another IO object so that small reads and writes don't each
+//   become a system call
+// NOTE: writes are kept until the buffer is full, 'kflush' is called, or the program exits
+typedef struct kio_bufio {
+
+    // the wrapped IO object
+    kobj io;
+
+    // capacity of each buffer, in bytes
+    usize cap;
+
+    // pending writes, which are 'wbuf[:wlen]'
+    u8* wbuf;
+    usize wlen;
+
+    // pending segments, in order, which are either in 'wbuf' or borrowed (see 'kwriteg'), and
+    //   their total size in bytes
+    struct kio_seg {
+        const u8* data;
+        usize len;
+    } segs[KIO_BUFIO_NSEG];
+    s32 nsegs;
+    usize slen;
+
+    // number of nested holds, while which borrowed segments may be pending (see 'kwriteg'), and
+    //   whether any are
+    // NOTE: only the outermost hold borrows, and nested ones copy, since a nested call may
+    //         free its data before the outermost hold is released
+    s32 hold;
+    bool borrowed;
+
+    // data read but not consumed yet, which is 'rbuf[rpos:rlen]'
+    u8* rbuf;
+    usize rpos, rlen;
+
+    // if true, flush writes after each newline (which is the default for terminals)
+    bool linebuf;
+
+    // lock for all of the above, which is also kept while held (see 'kio_hold')
+    // NOTE: buffered IO objects (like 'Kos_stdout') may be shared between threads
+    pthread_mutex_t lock_;
+
+    // list of all buffered IO objects, which are flushed at exit
+    struct kio_bufio *prev, *next;
+
+}* kio_bufio;
+
+// make a new buffered IO object wrapping 'io', with a given buffer size (or 0 for the
+//   default, 'KIO_BUFIO_CAP')
+// NOTE: if 'io' is a terminal, it is line buffered
+KATA_API kio_bufio
+kio_bufio_new(kobj io, usize cap);
+
+// flush every buffered IO object, which is done automatically at exit
+KATA_API void
+kio_flushall();
+
+
+// backends for 'kos_aio_new'
+enum {
+    // use io_uring if the kernel supports it, otherwise threads
+    KOS_AIO_AUTO       = 0,
+
+    // io_uring, which submits and completes in batches with a single system call
+    KOS_AIO_URING      = 1,
+    // pool of worker threads doing blocking IO (which is always available)
+    KOS_AIO_THREADS    = 2,
+
+};
+
+// kinds of async IO operations
+enum {
+    // read from 'fd' into a buffer, at 'buf->pos' (which is grown as needed)
+    KOS_AIO_READ       = 1,
+    // write to 'fd' from a buffer, from 'buf->pos'
+    KOS_AIO_WRITE      = 2,
+};
+
+// number of worker threads for 'KOS_AIO_THREADS'
+#define KOS_AIO_NTHREADS 4
+
+// async IO request, which is filled in by the caller, and must stay valid (and not be changed)
+//   until it is done
+struct kos_aio_req {
+
+    // kind of operation (see 'KOS_AIO_READ' and 'KOS_AIO_WRITE')
+    s32 kind;
+
+    // file descriptor to read or write
+    s32 fd;
+
+    // offset in the file, or -1 to use (and update) the current position, which is needed for
+    //   pipes and sockets
+    s64 off;
+
+    // buffer to transfer 'len' bytes to or from, starting at 'buf->pos', which is advanced by
+    //   the number of bytes transferred (the request holds a reference until it is done)
+    // NOTE: only one request at a time may use a buffer (others fail to submit), and it can't
+    //         be a ring (see 'kbuffer_ring'), since a transfer must be a single span of memory
+    kbuffer buf;
+    usize len;
+
+    // function called when the request is done (or NULL), and user data for it
+    // NOTE: it is called from 'kos_aio_poll' or 'kos_aio_wait', on the calling thread
+    void (*cb)(struct kos_aio_req* req);
+    void* user;
+
+    // whether the request is done, and the result, which is the number of bytes transferred
+    //   (0 for end of file), or a negative error number (i.e. '-errno')
+    bool done;
+    ssize res;
+
+    // (internal) next request in a queue
+    struct kos_aio_req* next_;
+
+};
+
+// async IO engine, which can keep many requests in flight from a single thread
+typedef struct kos_aio {
+
+    // backend, which is either 'KOS_AIO_URING' or 'KOS_AIO_THREADS'
+    s32 mode;
+
+    // number of requests submitted, but not completed yet
+    usize nflight;
+
+    // (internal) state for the backend
+    void* state_;
+
+}* kos_aio;
+
+// make a new async IO engine, which can have at least 'depth' requests in flight at once (more
+//   are queued until there is room), with a given backend (see 'KOS_AIO_*')
+// NOTE: returns NULL (and throws) if the backend isn't available
+KATA_API kos_aio
+kos_aio_new(u32 depth, s32 mode);
+
+// submit a request, which is sent in a batch by the next 'kos_aio_poll' or 'kos_aio_wait'
+// NOTE: returns an error (and throws) if the request is invalid, i.e. for a ring buffer
+KATA_API keno
+kos_aio_submit(kos_aio obj, struct kos_aio_req* req);
+
+// send submitted requests, and handle any that are done, without blocking
+// NOTE: returns the number of requests which are now done, or <0 on error
+KATA_API s32
+kos_aio_poll(kos_aio obj);
+
+// send submitted requests, and wait until at least 'min' are done (or nothing is in flight)
+// NOTE: returns the number of requests which are now done, or <0 on error
+KATA_API s32
+kos_aio_wait(kos_aio obj, s32 min);
+
+// wait for a specific request to be done, returning its result
+KATA_API ssize
+kos_aio_await(kos_aio obj, struct kos_aio_req* req);
+
+
 // kos_open() flags
 // TODO: https://linux.die.net/man/3/open
 enum {
@@ -52,14 +258,20 @@ KATA_API kobj
 kos_open(const char* path, u32 flags);
 
 // os module globals
-KATA_API kos_rawio
+// NOTE: the standard output and error are buffered (the latter is always line buffered)
+KATA_API kio_bufio
 Kos_stdout,
-Kos_stderr,
+Kos_stderr
+;
+KATA_API kos_rawio
 Kos_stdin
 ;
 
 KATA_API ktype
-Kos_rawio
+Kos_rawio,
+Kos_mmap,
+Kos_aio,
+Kio_bufio
 ;
 
 #endif // KATA_OS_H
@@ -0,0 +1,66 @@
+/* perf/call.c - overhead of calling C functions, including argument parsing
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+
+// number of calls per test
+#define NCALLS 10000000
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// function parsing arguments with 'KARGS' (which compiles the format once)
+static KCFUNC(my_spec_) {
+    kint a;
+    kobj b;
+    KARGS("a:! b", &a, Kint, &b);
+    return NULL;
+}
+
+// function parsing arguments with 'kargs' (which parses the format every call)
+static KCFUNC(my_fmt_) {
+    kint a;
+    kobj b;
+    if (!kargs(nargs, vargs, "a:! b", &a, Kint, &b)) return NULL;
+    return NULL;
+}
+
+// call 'fn' 'NCALLS' times, and return nanoseconds per call
+static f64
+my_run(kobj fn) {
+    kobj args[] = { (kobj)kint_news(1), (kobj)kint_news(2) };
+
+    usize i;
+    f64 st = my_time();
+    for (i = 0; i < NCALLS; ++i) {
+        kcall(fn, 2, args);
+    }
+    f64 et = my_time() - st;
+
+    KOBJ_DECREF(args[0]);
+    KOBJ_DECREF(args[1]);
+    return et / NCALLS * 1e9;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    kobj fspec = kfunc_new(my_spec_, "spec(a, b)", "");
+    kobj ffmt = kfunc_new(my_fmt_, "fmt(a, b)", "");
+
+    kprintf(Kos_stdout, "KARGS (compiled spec): %f ns/call\n", my_run(fspec));
+    kprintf(Kos_stdout, "kargs (format string): %f ns/call\n", my_run(ffmt));
+
+    KOBJ_DECREF(fspec);
+    KOBJ_DECREF(ffmt);
+    return 0;
+}
@@ -0,0 +1,64 @@
+/* perf/copy.c - copying a file, with 'kcopy' and through a user space buffer
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+#include <unistd.h>
+
+// size of the file, in bytes
+#define FILESZ (64 * 1024 * 1024)
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// copy all of 'sfd' to 'dfd' (from the start), with 'kcopy' if 'kern', and return the speed
+//   (in MB/s)
+static f64
+my_run(s32 sfd, s32 dfd, bool kern) {
+    lseek(sfd, 0, SEEK_SET);
+    lseek(dfd, 0, SEEK_SET);
+    kos_rawio src = kos_rawio_newd(sfd), dst = kos_rawio_newd(dfd);
+
+    f64 st = my_time();
+    if (kern) {
+        kcopy((kobj)src, (kobj)dst, -1);
+    } else {
+        static u8 buf[64 * 1024];
+        ssize sz;
+        while ((sz = kread((kobj)src, sizeof(buf), buf)) > 0) kwrite((kobj)dst, sz, buf);
+    }
+    f64 et = my_time() - st;
+
+    KOBJ_DECREF(src);
+    KOBJ_DECREF(dst);
+    return FILESZ / et / 1e6;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    char path0[] = "/tmp/kata-perf-copy-XXXXXX", path1[] = "/tmp/kata-perf-copy-XXXXXX";
+    s32 fd0 = mkstemp(path0), fd1 = mkstemp(path1);
+    unlink(path0);
+    unlink(path1);
+
+    u8* data = kmem_make(FILESZ);
+    memset(data, 'x', FILESZ);
+    write(fd0, data, FILESZ);
+    kmem_free(data);
+
+    kprintf(Kos_stdout, "read/write: %f MB/s\n", my_run(fd0, fd1, false));
+    kprintf(Kos_stdout, "kcopy: %f MB/s\n", my_run(fd0, fd1, true));
+
+    close(fd0);
+    close(fd1);
+    return 0;
+}
@@ -0,0 +1,90 @@
+/* perf/fmt.c - formatting numbers, compared to C's snprintf
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+
+// number of values formatted per test
+#define NVALS 4000000
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// pseudo-random values, of all lengths
+static u64
+my_val(usize i) {
+    u64 x = (i + 1) * 0x9E3779B97F4A7C15ULL;
+    return x >> (x % 61);
+}
+
+// format 'NVALS' integers into a buffer, with 'kwrites' or snprintf, and return Mvals/s
+static f64
+my_ints(bool libc) {
+    kbuffer buf = kbuffer_new(0, NULL);
+    char tmp[64];
+
+    usize i;
+    f64 st = my_time();
+    for (i = 0; i < NVALS; ++i) {
+        s64 v = (s64)my_val(i) * (i % 2 ? 1 : -1);
+        if (libc) {
+            int len = snprintf(tmp, sizeof(tmp), "%lld ", (long long)v);
+            kwrite((kobj)buf, len, tmp);
+        } else {
+            kwrites((kobj)buf, v, 10, 0, KWRITE_NONE);
+            kwrite((kobj)buf, 1, " ");
+        }
+        if (buf->len > 65536) buf->len = 0;
+    }
+    f64 et = my_time() - st;
+
+    KOBJ_DECREF(buf);
+    return NVALS / et / 1e6;
+}
+
+// format 'NVALS' floats into a buffer, with 'kwritef' or snprintf (shortest round trip if
+//   'prec<0', like '%.17g' in C, which is longer), and return Mvals/s
+static f64
+my_floats(bool libc, s32 prec) {
+    kbuffer buf = kbuffer_new(0, NULL);
+    char tmp[64];
+
+    usize i;
+    f64 st = my_time();
+    for (i = 0; i < NVALS; ++i) {
+        f64 v = (f64)my_val(i) / (my_val(i + 1) | 1);
+        if (libc) {
+            int len = prec < 0 ? snprintf(tmp, sizeof(tmp), "%.17g ", v) : snprintf(tmp, sizeof(tmp), "%.*f ", (int)prec, v);
+            kwrite((kobj)buf, len, tmp);
+        } else {
+            kwritef((kobj)buf, v, 10, 0, prec, KWRITE_NONE);
+            kwrite((kobj)buf, 1, " ");
+        }
+        if (buf->len > 65536) buf->len = 0;
+    }
+    f64 et = my_time() - st;
+
+    KOBJ_DECREF(buf);
+    return NVALS / et / 1e6;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    kprintf(Kos_stdout, "ints, snprintf: %.2f Mvals/s\n", my_ints(true));
+    kprintf(Kos_stdout, "ints, kwrites:  %.2f Mvals/s\n", my_ints(false));
+    kprintf(Kos_stdout, "floats, snprintf (%%.17g): %.2f Mvals/s\n", my_floats(true, -1));
+    kprintf(Kos_stdout, "floats, kwritef (shortest): %.2f Mvals/s\n", my_floats(false, -1));
+    kprintf(Kos_stdout, "floats, snprintf (%%.3f): %.2f Mvals/s\n", my_floats(true, 3));
+    kprintf(Kos_stdout, "floats, kwritef (%%.3f):  %.2f Mvals/s\n", my_floats(false, 3));
+
+    return 0;
+}
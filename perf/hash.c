@@ -0,0 +1,137 @@
+/* perf/hash.c - throughput and quality of 'kmem_hash' versus djb2
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+
+// number of bytes to hash for each size
+#define NBYTES (256 * 1024 * 1024)
+
+// number of keys for the distribution test
+#define NKEYS (1 << 20)
+
+// number of buckets for the distribution test
+#define NBUKS (1 << 16)
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the previous hash function, for comparison
+static usize
+my_djb2(usize len, const u8* data) {
+    usize res = 5381, i;
+    for (i = 0; i < len; i++) {
+        res = res * 33 + data[i];
+    }
+    return res;
+}
+
+// hash many buffers of a given size, and return the throughput in GB/s
+static f64
+my_rate(usize (*fn)(usize, const u8*), usize len, const u8* data) {
+    usize n = NBYTES / len, i, acc = 0;
+    f64 st = my_time();
+    for (i = 0; i < n; ++i) {
+        // change the input a bit, so calls can't be merged
+        acc ^= fn(len - (i & 1), data + (acc & 1));
+    }
+    f64 et = my_time() - st;
+
+    // keep the result alive
+    if (acc == 42) printf("\n");
+    return (f64)n * len / et / 1e9;
+}
+
+// compute the chi-squared statistic of the low bits of the hashes of 'key%i' (which
+//   should be close to 1.0 for a uniform hash)
+static f64
+my_chi2(usize (*fn)(usize, const u8*)) {
+    static usize buks[NBUKS];
+    memset(buks, 0, sizeof(buks));
+
+    usize i;
+    char key[64];
+    for (i = 0; i < NKEYS; ++i) {
+        int len = snprintf(key, sizeof(key), "key%i", (int)i);
+        buks[fn(len, (u8*)key) % NBUKS]++;
+    }
+
+    f64 exp = (f64)NKEYS / NBUKS, res = 0;
+    for (i = 0; i < NBUKS; ++i) {
+        f64 d = buks[i] - exp;
+        res += d * d / exp;
+    }
+
+    return res / (NBUKS - 1);
+}
+
+// compute the worst avalanche bias, which is how far the probability of an output bit
+//   flipping when a single input bit is flipped strays from 0.5
+static f64
+my_avalanche(usize (*fn)(usize, const u8*), usize len) {
+    static usize flips[64 * 8][64];
+    memset(flips, 0, sizeof(flips));
+
+    u8 data[64];
+    usize ntrials = 2000, t, i, j;
+    u64 rng = 0x1234567;
+    for (t = 0; t < ntrials; ++t) {
+        for (i = 0; i < len; ++i) {
+            rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+            data[i] = rng >> 56;
+        }
+        usize h = fn(len, data);
+        for (i = 0; i < len * 8; ++i) {
+            data[i / 8] ^= 1 << (i % 8);
+            usize d = h ^ fn(len, data);
+            data[i / 8] ^= 1 << (i % 8);
+            for (j = 0; j < 64; ++j) flips[i][j] += (d >> j) & 1;
+        }
+    }
+
+    f64 worst = 0;
+    for (i = 0; i < len * 8; ++i) {
+        for (j = 0; j < 64; ++j) {
+            f64 b = (f64)flips[i][j] / ntrials - 0.5;
+            if (b < 0) b = -b;
+            if (b > worst) worst = b;
+        }
+    }
+
+    return worst;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    static u8 data[64 * 1024 + 1];
+    usize i;
+    for (i = 0; i < sizeof(data); ++i) data[i] = i * 2654435761u >> 24;
+
+    printf("throughput (GB/s):\n");
+    static const usize sizes[] = { 8, 16, 32, 64, 256, 4096, 64 * 1024 };
+    for (i = 0; i < sizeof(sizes) / sizeof(*sizes); ++i) {
+        f64 rk = my_rate(kmem_hash, sizes[i], data);
+        f64 rd = my_rate(my_djb2, sizes[i], data);
+        printf("  %6i bytes: kmem_hash %6.2f, djb2 %6.2f (%.1fx)\n", (int)sizes[i], rk, rd, rk / rd);
+    }
+
+    printf("distribution of 'key%%i' in %i buckets (chi2/df, ~1.0 is ideal):\n", NBUKS);
+    printf("  kmem_hash %.3f, djb2 %.3f\n", my_chi2(kmem_hash), my_chi2(my_djb2));
+
+    printf("worst avalanche bias (0.0 is ideal):\n");
+    static const usize alens[] = { 4, 16, 40 };
+    for (i = 0; i < sizeof(alens) / sizeof(*alens); ++i) {
+        printf("  %6i bytes: kmem_hash %.3f, djb2 %.3f\n", (int)alens[i], my_avalanche(kmem_hash, alens[i]), my_avalanche(my_djb2, alens[i]));
+    }
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+/* perf/int.c - integer arithmetic throughput, for small (native) and big (libbf) values
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+
+// number of operations per test
+#define NOPS 4000000
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// sum 'x * 3 + i' for 'NOPS' iterations, starting from 'x', and return Mops/s
+static f64
+my_run(kint x) {
+    kint three = kint_news(3);
+    kobj acc = (kobj)x;
+    KOBJ_INCREF(acc);
+
+    usize i;
+    f64 st = my_time();
+    for (i = 0; i < NOPS; ++i) {
+        kint ki = kint_news(i % 1024);
+        kobj t = kop_mul((kobj)ki, (kobj)three);
+        kobj s = kop_add(acc, t);
+        KOBJ_DECREF(t);
+        KOBJ_DECREF(ki);
+        KOBJ_DECREF(acc);
+        acc = s;
+    }
+    f64 et = my_time() - st;
+
+    KOBJ_DECREF(acc);
+    KOBJ_DECREF(three);
+    return 2.0 * NOPS / et / 1e6;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    kint small = kint_news(12345);
+    kint big = kint_new("123456789012345678901234567890", 10);
+
+    kprintf(Kos_stdout, "small (s64) ints: %f Mops/s\n", my_run(small));
+    kprintf(Kos_stdout, "big (libbf) ints: %f Mops/s\n", my_run(big));
+
+    KOBJ_DECREF(small);
+    KOBJ_DECREF(big);
+    return 0;
+}
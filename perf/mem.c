@@ -0,0 +1,140 @@
+/* perf/mem.c - allocation throughput of 'kmem' versus the C library
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+#include <pthread.h>
+
+// number of blocks live at once
+#define NLIVE 4096
+
+// number of rounds of allocating and freeing 'NLIVE' blocks
+#define NROUNDS 2000
+
+// number of times to grow a huge block, and by how much
+#define NGROW 4096
+#define GROW_SZ (64 * 1024)
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// maximum number of threads to test
+#define NTHREADS 8
+
+// get the size of the 'i'th allocation, which are all small (16-256 bytes)
+static usize
+my_size(usize i) {
+    return 16 + (i * 2654435761u) % 241;
+}
+
+// run a round of allocations on a thread
+static void*
+my_thread(void* arg) {
+    void** blks = kmem_make(sizeof(*blks) * NLIVE);
+    usize r, i;
+    for (r = 0; r < NROUNDS / NTHREADS; ++r) {
+        for (i = 0; i < NLIVE; ++i) blks[i] = kmem_make(my_size(i + r));
+        for (i = 0; i < NLIVE; ++i) kmem_free(blks[i]);
+    }
+    kmem_free(blks);
+    return NULL;
+}
+
+// allocate blocks, which are then freed on another thread
+static void*
+my_producer(void* arg) {
+    void** blks = arg;
+    usize i;
+    for (i = 0; i < NLIVE; ++i) blks[i] = kmem_make(my_size(i));
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    static void* blks[NLIVE];
+    usize r, i;
+    f64 st, et;
+    f64 nops = (f64)NROUNDS * NLIVE;
+
+    // C library
+    st = my_time();
+    for (r = 0; r < NROUNDS; ++r) {
+        for (i = 0; i < NLIVE; ++i) blks[i] = malloc(my_size(i + r));
+        for (i = 0; i < NLIVE; ++i) free(blks[i]);
+    }
+    et = my_time() - st;
+    kprintf(Kos_stdout, "malloc/free:         %f Mops/s\n", nops / et / 1e6);
+
+    // kmem
+    st = my_time();
+    for (r = 0; r < NROUNDS; ++r) {
+        for (i = 0; i < NLIVE; ++i) blks[i] = kmem_make(my_size(i + r));
+        for (i = 0; i < NLIVE; ++i) kmem_free(blks[i]);
+    }
+    et = my_time() - st;
+    kprintf(Kos_stdout, "kmem_make/kmem_free: %f Mops/s\n", nops / et / 1e6);
+
+    // objects
+    st = my_time();
+    for (r = 0; r < NROUNDS; ++r) {
+        for (i = 0; i < NLIVE; ++i) blks[i] = kobj_make(Kdict);
+        for (i = 0; i < NLIVE; ++i) kobj_del(blks[i]);
+    }
+    et = my_time() - st;
+    kprintf(Kos_stdout, "kobj_make/kobj_del:  %f Mops/s\n", nops / et / 1e6);
+
+    // threads, each doing the same amount of work
+    usize nt;
+    for (nt = 1; nt <= NTHREADS; nt *= 2) {
+        pthread_t thds[NTHREADS];
+        st = my_time();
+        for (i = 0; i < nt; ++i) pthread_create(&thds[i], NULL, my_thread, NULL);
+        for (i = 0; i < nt; ++i) pthread_join(thds[i], NULL);
+        et = my_time() - st;
+        kprintf(Kos_stdout, "kmem, %i threads:      %f Mops/s\n", (int)nt, nt * ((f64)NROUNDS / NTHREADS * NLIVE) / et / 1e6);
+    }
+
+    // cross-thread frees
+    st = my_time();
+    for (r = 0; r < NROUNDS / 10; ++r) {
+        pthread_t thd;
+        pthread_create(&thd, NULL, my_producer, blks);
+        pthread_join(thd, NULL);
+        for (i = 0; i < NLIVE; ++i) kmem_free(blks[i]);
+    }
+    et = my_time() - st;
+    kprintf(Kos_stdout, "kmem, remote frees:   %f Mops/s\n", (f64)NROUNDS / 10 * NLIVE / et / 1e6);
+
+    // growing a huge block a little at a time, touching the new part each time
+    void* big = NULL;
+    usize cap = 0;
+    st = my_time();
+    for (i = 1; i <= NGROW; ++i) {
+        kmem_growx(&big, &cap, i * GROW_SZ);
+        memset((u8*)big + (i - 1) * GROW_SZ, i, GROW_SZ);
+    }
+    et = my_time() - st;
+    kmem_free(big);
+    kprintf(Kos_stdout, "kmem_growx, to %iMB:  %f GB/s\n", (int)(NGROW * GROW_SZ >> 20), (f64)NGROW * GROW_SZ / et / 1e9);
+
+    big = NULL;
+    st = my_time();
+    for (i = 1; i <= NGROW; ++i) {
+        big = realloc(big, i * GROW_SZ);
+        memset((u8*)big + (i - 1) * GROW_SZ, i, GROW_SZ);
+    }
+    et = my_time() - st;
+    free(big);
+    kprintf(Kos_stdout, "realloc, to %iMB:     %f GB/s\n", (int)(NGROW * GROW_SZ >> 20), (f64)NGROW * GROW_SZ / et / 1e9);
+
+    return 0;
+}
@@ -0,0 +1,55 @@
+/* perf/str.c - building a long string by repeated concatenation
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+
+// number of pieces to concatenate
+#define NPIECES 100000
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// concatenate 'NPIECES' copies of 'piece', in place if 'inplace', and return the time per
+//   concatenation (in ns), including flattening the result
+static f64
+my_run(kstr piece, bool inplace) {
+    kstr res = kstr_new(0, "");
+
+    usize i;
+    f64 st = my_time();
+    for (i = 0; i < NPIECES; ++i) {
+        if (inplace) {
+            res = (kstr)kop_addz((kobj)res, (kobj)piece);
+        } else {
+            kstr t = (kstr)kop_add((kobj)res, (kobj)piece);
+            KOBJ_DECREF(res);
+            res = t;
+        }
+    }
+    KSTR_DATA(res);
+    f64 et = my_time() - st;
+
+    KOBJ_DECREF(res);
+    return et / NPIECES * 1e9;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    kstr piece = kstr_new(-1, "the quick brown fox jumps over the lazy dog\n");
+
+    kprintf(Kos_stdout, "rope (a + b): %f ns/concat\n", my_run(piece, false));
+    kprintf(Kos_stdout, "in place (a += b): %f ns/concat\n", my_run(piece, true));
+
+    KOBJ_DECREF(piece);
+    return 0;
+}
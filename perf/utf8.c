@@ -0,0 +1,74 @@
+/* perf/utf8.c - throughput of UTF-8 validation (see 'kstr_utf8') versus memcpy
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/api.h>
+
+#include <time.h>
+
+// size of the text
+#define NBYTES (64 * 1024 * 1024)
+
+// number of passes over the text
+#define NREPS 8
+
+// get the current time, in seconds
+static f64
+my_time() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// fill 'data' with text, cycling through 'pat' (which is valid UTF-8)
+static void
+my_fill(u8* data, const char* pat) {
+    usize n = strlen(pat), i;
+    for (i = 0; i + n <= NBYTES; i += n) memcpy(data + i, pat, n);
+    for (; i < NBYTES; ++i) data[i] = ' ';
+}
+
+// validate 'data', and return the throughput in GB/s
+static f64
+my_rate(const u8* data) {
+    usize i, lenc = 0;
+    f64 st = my_time();
+    for (i = 0; i < NREPS; ++i) {
+        bool ok = kstr_utf8(NBYTES, data, &lenc);
+        assert(ok);
+    }
+    f64 et = my_time() - st;
+    return (f64)NBYTES * NREPS / et / 1e9;
+}
+
+// copy 'data', and return the throughput in GB/s
+static f64
+my_rate_memcpy(const u8* data, u8* dst) {
+    usize i;
+    f64 st = my_time();
+    for (i = 0; i < NREPS; ++i) {
+        memcpy(dst, data, NBYTES);
+        dst[i] ^= data[i];
+    }
+    f64 et = my_time() - st;
+    return (f64)NBYTES * NREPS / et / 1e9;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    u8* data = kmem_make(NBYTES);
+    u8* dst = kmem_make(NBYTES);
+
+    my_fill(data, "the quick brown fox jumps over the lazy dog. ");
+    printf("memcpy:           %6.2f GB/s\n", my_rate_memcpy(data, dst));
+    printf("utf8 (ASCII):     %6.2f GB/s\n", my_rate(data));
+
+    my_fill(data, "h\xc3\xa9llo w\xc3\xb6rld, \xe2\x82\xac \xe6\x97\xa5\xe6\x9c\xac \xf0\x9f\x98\x80 ");
+    printf("utf8 (non-ASCII): %6.2f GB/s\n", my_rate(data));
+
+    kmem_free(data);
+    kmem_free(dst);
+    return 0;
+}
@@ -6,7 +6,10 @@
 #include <kata/impl.h>
 
 kdict
-Kglobals
+Kglobals;
+
+klist
+Ktypes
 ;
 
 kstr
@@ -16,47 +19,49 @@ Ksc_del
 ;
 
 
+// (internal) make an object immortal, along with everything it refers to
+static void
+my_immortal_all(kobj obj) {
+    if (!obj || KOBJ_ISIMMORTAL(obj)) return;
+    kobj_immortal(obj);
 
-// write UTF-8 string data, escaped
-static ssize
-mywrite_stresc(kobj io, ssize len, const u8* data) {
-    if (len < 0) len = strlen((const char*)data);
-    // total bytes written
-    ssize res = 0;
-
-    // internal buffer
-    #define TMP_LEN 272
-    // send every this many bytes
-    #define TMP_EVERY 256
-    u8 tmp[TMP_LEN];
-    usize tmpi = 0;
-
-    tmp[tmpi++] = '"';
-
-    // check the buffer
-    #define TMP_SEND() do { \
-        ssize rsz = kwrite(io, tmpi, tmp); \
-        if (rsz < 0) return rsz; \
-        res += rsz; \
-        tmpi = 0; \
-    } while (0)
-
-    usize i = 0;
-    while (i < len) {
-        if (tmpi > TMP_EVERY) TMP_SEND();
-
-        // take care of bytes
-        // TODO: allow customization?
-        // TODO: faster to not buffer contiguous non-escaped strings?
-        u8 b = data[i++];
-        memcpy(tmp + tmpi, Kescstr[b], Kescstr_len[b]);
-        tmpi += Kescstr_len[b];
+    ktype tp = KOBJ_TYPE(obj);
+    usize i;
+    if (tp == Ktype) {
+        ktype v = (ktype)obj;
+        my_immortal_all((kobj)v->name);
+        my_immortal_all((kobj)v->docs);
+        my_immortal_all((kobj)v->attr);
+    } else if (tp == Kfunc) {
+        kfunc v = (kfunc)obj;
+        my_immortal_all((kobj)v->name);
+        my_immortal_all((kobj)v->docs);
+    } else if (tp == Ktuple) {
+        ktuple v = (ktuple)obj;
+        for (i = 0; i < v->len; ++i) my_immortal_all(v->data[i]);
+    } else if (tp == Klist) {
+        klist v = (klist)obj;
+        for (i = 0; i < v->len; ++i) my_immortal_all(v->data[i]);
+    } else if (tp == Kdict) {
+        kdict v = (kdict)obj;
+        for (i = 0; i < v->ents_len; ++i) {
+            if (v->ents[i].key) {
+                my_immortal_all(v->ents[i].key);
+                my_immortal_all(v->ents[i].val);
+            }
+        }
+    } else if (tp == Kio_bufio) {
+        my_immortal_all(((kio_bufio)obj)->io);
     }
+}
 
-    // send rest of data
-    tmp[tmpi++] = '"';
-    TMP_SEND();
-    return res;
+// (internal) make a type and everything it refers to immortal
+// NOTE: types are already immortal, so 'my_immortal_all' would stop at them
+static void
+my_immortal_type(ktype tp) {
+    my_immortal_all((kobj)tp->name);
+    my_immortal_all((kobj)tp->docs);
+    my_immortal_all((kobj)tp->attr);
 }
 
 
@@ -76,9 +81,9 @@ kinit(bool fail_on_err) {
 
     Kos_rawio->sz = sizeof(struct kos_rawio);
 
-    Ksc_repr = kstr_new(-1, "__repr");
-    Ksc_new = kstr_new(-1, "__new");
-    Ksc_del = kstr_new(-1, "__del");
+    Ksc_repr = kstr_intern(-1, "__repr");
+    Ksc_new = kstr_intern(-1, "__new");
+    Ksc_del = kstr_intern(-1, "__del");
 
     bf_context_init(&kbf_ctx, kbf_realloc, NULL);
 
@@ -87,6 +92,7 @@ kinit(bool fail_on_err) {
     // initialize builtin types
 
     kinit_str();
+    kinit_buffer();
 
     kinit_int();
     kinit_float();
@@ -99,6 +105,15 @@ kinit(bool fail_on_err) {
     kinit_func();
     kinit_exc();
 
+    kinit_ops();
+
+    // types made before the list of types
+    Ktypes = klist_new(9, (kobj[]){
+        (kobj)Kstr, (kobj)Kbuffer, (kobj)Kint, (kobj)Kfloat, (kobj)Ktuple,
+        (kobj)Klist, (kobj)Kdict, (kobj)Kfunc, (kobj)Kexc,
+    });
+    assert(Ktypes != NULL);
+
     Kglobals = kdict_new(KDICT_IKV(
         { "int", Kint },
         { "str", Kstr },
@@ -110,11 +125,26 @@ kinit(bool fail_on_err) {
     kinit_os();
     kinit_ks();
 
+    // everything made so far lives until exit, and is shared between threads, so make it
+    //   immortal to avoid writing to reference counts
+    usize i;
+    for (i = 0; i < Ktypes->len; ++i) my_immortal_type((ktype)Ktypes->data[i]);
+    my_immortal_all((kobj)Ktypes);
+    my_immortal_all((kobj)Kglobals);
+    my_immortal_all((kobj)Ksc_repr);
+    my_immortal_all((kobj)Ksc_new);
+    my_immortal_all((kobj)Ksc_del);
+    my_immortal_all((kobj)Kos_stdin);
+    my_immortal_all((kobj)Kos_stdout);
+    my_immortal_all((kobj)Kos_stderr);
+
     return true;
 }
 
 KATA_API void
 kexit(keno rc) {
+    // NOTE: 'exit' flushes too (with 'atexit'), but 'abort' doesn't
+    kio_flushall();
     if (rc == 0) {
         exit(0);
     } else {
@@ -148,13 +178,29 @@ KATA_API kobj
 kobj_make(ktype tp) {
     assert(tp != NULL);
     assert(tp->sz > 0);
-    struct kobj_meta* meta = kmem_make(sizeof(struct kobj_meta) + tp->sz);
+    return kobj_makex(tp, tp->sz);
+}
+
+KATA_API kobj
+kobj_makex(ktype tp, usize sz) {
+    return kobj_makea(NULL, tp, sz);
+}
+
+KATA_API kobj
+kobj_makea(struct kmem_arena* arena, ktype tp, usize sz) {
+    assert(tp != NULL);
+    struct kobj_meta* meta = arena ? kmem_arena_make(arena, sizeof(struct kobj_meta) + sz) : kmem_make(sizeof(struct kobj_meta) + sz);
     if (!meta) return NULL;
 
     // initialize object meta
     meta->type = tp;
     meta->refc = 1;
 
+#if KATA_MEM_STATS
+    // NOTE: objects in arenas aren't counted, since they are released all at once
+    if (!arena) kmem_stats_onobj(tp, 1, kmem_sizeof(meta));
+#endif
+
     return KOBJ_UNMETA(meta);
 }
 
@@ -164,11 +210,21 @@ kobj_newref(kobj obj) {
     return obj;
 }
 
+KATA_API void
+kobj_immortal(kobj obj) {
+    if (KOBJ_ISTAG(obj)) return;
+    KOBJ_REFC(obj) = KOBJ_IMMORTAL;
+}
+
 KATA_API void
 kobj_free(kobj obj) {
     ktype tp = KOBJ_TYPE(obj);
     kobj res;
-    if (tp->fn_del) {
+    if (tp->c_del) {
+        // call C deleter directly
+        tp->c_del(obj);
+
+    } else if (tp->fn_del) {
 
         // call deleter
         res = kqcall(tp->fn_del, 1, (kobj[]){ obj });
@@ -184,18 +240,23 @@ kobj_free(kobj obj) {
         //KOBJ_DECREF(res);
 
         // manually free memory
-        kmem_free(KOBJ_META(obj));
+        kobj_del(obj);
     } else {
         // use default delete, which is to delete the memory
-        kmem_free(KOBJ_META(obj));
+        kobj_del(obj);
     }
 }
 
 // deletes object, should only be called by other deleters, or GCs
 KATA_API void
 kobj_del(kobj obj) {
+    struct kobj_meta* meta = KOBJ_META(obj);
+#if KATA_MEM_STATS
+    if (kmem_pmap_get(meta) != KMEM_CHUNK_ARENA) kmem_stats_onobj(meta->type, -1, -(s64)kmem_sizeof(meta));
+#endif
+
     // use default delete, which is to delete the memory
-    kmem_free(KOBJ_META(obj));
+    kmem_free(meta);
 }
 
 KATA_API bool
@@ -213,6 +274,11 @@ kobj_gets(kobj obj, s64* out) {
     ktype tp = KOBJ_TYPE(obj);
 
     if (tp == Kint) {
+        if (KINT_ISSMALL(obj)) {
+            *out = KINT_SMALL(obj);
+            return true;
+        }
+
         int64_t tmp;
         if (bf_get_int64(&tmp, &((kint)obj)->val, 0) != 0) {
             // overflow
@@ -240,12 +306,30 @@ kobj_getc(kobj obj, f64* outre, f64* outim) {
 
 KATA_API bool
 kobj_hash(kobj obj, usize* out) {
+    ktype tp = KOBJ_TYPE(obj);
+    if (tp->c_hash) return tp->c_hash(obj, out);
 
+    // TODO: call '__hash'
+    // default is to hash by identity
+    usize id = (usize)obj;
+    *out = kmem_hash(sizeof(id), (const u8*)&id);
+    return true;
 }
 
 KATA_API bool
 kobj_eq(kobj a, kobj b, bool* out) {
+    if (a == b) {
+        *out = true;
+        return true;
+    }
+
+    ktype tp = KOBJ_TYPE(a);
+    if (tp->c_eq) return tp->c_eq(a, b, out);
 
+    // TODO: call '__eq'
+    // default is to compare by identity
+    *out = false;
+    return true;
 }
 
 KATA_API void*
@@ -271,17 +355,10 @@ kcall(kobj fn, usize nargs, kobj* vargs) {
     //}
 
     // run the function, depending on the type
-    // NOTE: these are some hard-coded common cases
     ktype tp = KOBJ_TYPE(fn);
     kobj res = NULL;
-    if (tp == Kfunc) {
-        kfunc kfn = (kfunc)fn;
-        if (kfn->kind & KFUNC_CFUNC) {
-            res = kfn->cfunc_(nargs, vargs);
-        } else {
-            kexit(-1);
-            return NULL;
-        }
+    if (tp->c_call) {
+        res = tp->c_call(fn, nargs, vargs);
     } else {
         assert(false);
     }
@@ -314,102 +391,124 @@ kargs(s32 nargs, kobj* vargs, const char* fmt, ...) {
 
 KATA_API bool
 kargsv(s32 nargs, kobj* vargs, const char* fmt, va_list ap) {
-    // position and length in 'fmt'
-    s32 i = 0;
-    s32 slen = strlen(fmt);
+    struct kargs_spec spec;
+    if (!kargs_compile(&spec, fmt)) return false;
+
+    // collect destinations (and types), in the same layout as 'KARGS'
+    void* args[2 * KARGS_MAX];
+    s32 i, j = 0;
+    for (i = 0; i < spec.nargs; ++i) {
+        args[j++] = va_arg(ap, void*);
+        if ((spec.typed >> i) & 1) args[j++] = va_arg(ap, void*);
+    }
+
+    return kargs_spec(&spec, nargs, vargs, fmt, args);
+}
 
-    // position of in arguments
-    s32 ai = 0;
+KATA_API bool
+kargs_compile(struct kargs_spec* spec, const char* fmt) {
+    spec->nargs = 0;
+    spec->typed = 0;
 
     // skip white space
     #define SKIPWS() do { \
-        while (i < slen && (fmt[i] == ' ' || fmt[i] == '\t')) i++; \
+        while (*fmt == ' ' || *fmt == '\t') fmt++; \
     } while (0)
 
-    char name[256];
     while (true) {
         // skip whitespace
         SKIPWS();
-        if (i >= slen) break;
+        if (!*fmt) break;
 
         // now, we expect a name
-        s32 j = 0;
-        while (i < slen && fmt[i] != ':' && fmt[i] != ' ') {
-            name[j++] = fmt[i++];
-        }
-        name[j] = '\0';
-
+        const char* name = fmt;
+        while (*fmt && *fmt != ':' && *fmt != ' ' && *fmt != '\t' && *fmt != ',') fmt++;
 
         // invalid name
-        if (j == 0) {
-            break;
-        }
-
-        //printf("NAME: '%s'\n", name);
+        if (fmt == name) break;
 
-        // pointer to the argument destination
-        void* parg = va_arg(ap, void*);
-
-        // not enough arguments for the format string
-        if (ai >= nargs) {
+        if (spec->nargs >= KARGS_MAX) {
             kexit(-1);
             return false;
         }
 
-        // otherwise, take the argument value that was passed in
-        kobj val = vargs[ai++];
-
         // now, check for validation
         SKIPWS();
-        if (fmt[i] == ':') {
+        if (*fmt == ':') {
             // skip colon
-            i++;
+            fmt++;
             SKIPWS();
 
             // parse type expression
-            if (fmt[i] == '!') {
+            if (*fmt == '!') {
                 // take from arguments
-                i++;
-                ktype tp = va_arg(ap, ktype);
-                bool good;
-                if (!kis(val, (kobj)tp, &good)) {
-                    return false;
-                }
-
-                // set to value, no extra reference
-                *(kobj*)parg = val;
+                fmt++;
+                spec->typed |= (u32)1 << spec->nargs;
             } else {
                 assert(false);
                 kexit(-1);
+                return false;
             }
-        } else if (i < slen) {
-            // accept any argument
-            printf("'%s'\n", fmt+i);
-            assert(false);
-        } else {
-            // set to value, no extra reference
-            *(kobj*)parg = val;
         }
+        spec->nargs++;
 
         // skip comma
         SKIPWS();
-        if (fmt[i] == ',') i++;
+        if (*fmt == ',') fmt++;
     }
     SKIPWS();
 
+    #undef SKIPWS
+
     // extra characters
-    if (fmt[i] != '\0') {
+    if (*fmt != '\0') {
         kexit(-1);
         return false;
     }
 
-    // extra args
-    // TODO: should this be an error, or also check for allowing none?
-    if (ai < nargs) {
+    spec->ok = true;
+    return true;
+}
+
+KATA_API bool
+kargs_spec(struct kargs_spec* spec, s32 nargs, kobj* vargs, const char* fmt, void** args) {
+    // NOTE: threads racing to compile the same spec write the same values, so only
+    //         'ok' needs to be ordered
+    if (!__atomic_load_n(&spec->ok, __ATOMIC_ACQUIRE)) {
+        struct kargs_spec tmp;
+        if (!kargs_compile(&tmp, fmt)) return false;
+        spec->nargs = tmp.nargs;
+        spec->typed = tmp.typed;
+        __atomic_store_n(&spec->ok, true, __ATOMIC_RELEASE);
+    }
+
+    // not enough (or too many) arguments for the format string
+    // TODO: should extra args be an error, or also check for allowing none?
+    if (nargs != spec->nargs) {
         kexit(-1);
         return false;
     }
 
+    s32 i;
+    for (i = 0; i < nargs; ++i) {
+        kobj val = vargs[i];
+        if ((spec->typed >> i) & 1) {
+            if (KOBJ_TYPE(val) != (ktype)args[1]) {
+                // TODO: throw a type error
+                kexit(-1);
+                return false;
+            }
+
+            // set to value, no extra reference
+            *(kobj*)args[0] = val;
+            args += 2;
+        } else {
+            // set to value, no extra reference
+            *(kobj*)args[0] = val;
+            args += 1;
+        }
+    }
+
     return true;
 }
 
@@ -429,6 +528,19 @@ kread(kobj io, usize len, void* data) {
     if (tp == Kbuffer) {
         // buffer read
         kbuffer tio = (kbuffer)io;
+        if (tio->ring) {
+            // ring read, which may be in two pieces
+            usize rsz = 0, n;
+            while (rsz < len) {
+                const u8* src = kbuffer_peek(tio, &n);
+                if (n == 0) break;
+                if (n > len - rsz) n = len - rsz;
+                memcpy((u8*)data + rsz, src, n);
+                kbuffer_consume(tio, n);
+                rsz += n;
+            }
+            return rsz;
+        }
 
         // get possible bytes to read
         ssize rsz = tio->len - tio->pos;
@@ -447,6 +559,19 @@ kread(kobj io, usize len, void* data) {
         if (rsz < 0) return -1;
 
         return rsz;
+    } else if (tp == Kos_mmap) {
+        // memory map read, which is like a buffer
+        kos_mmap tio = (kos_mmap)io;
+
+        ssize rsz = tio->len - tio->pos;
+        if (rsz > len) rsz = len;
+
+        memcpy(data, tio->data + tio->pos, rsz);
+        tio->pos += rsz;
+
+        return rsz;
+    } else if (tp == Kio_bufio) {
+        return kio_bufio_read((kio_bufio)io, len, data);
     } else {
         // TODO: throw error?
         return -1;
@@ -457,8 +582,22 @@ KATA_API ssize
 kwrite(kobj io, usize len, const void* data) {
     ktype tp = KOBJ_TYPE(io);
     if (tp == Kbuffer) {
-        // buffer read
+        // buffer write
         kbuffer tio = (kbuffer)io;
+        if (tio->ring) {
+            // ring write, which may be in two pieces, and only writes what fits
+            usize rsz = 0, n;
+            while (rsz < len) {
+                n = len - rsz;
+                u8* dst = kbuffer_reserve(tio, &n);
+                if (n == 0) break;
+                if (n > len - rsz) n = len - rsz;
+                memcpy(dst, (const u8*)data + rsz, n);
+                kbuffer_commit(tio, n);
+                rsz += n;
+            }
+            return rsz;
+        }
 
         // get possible bytes to read
         ssize rsz = tio->cap - tio->pos;
@@ -476,8 +615,21 @@ kwrite(kobj io, usize len, const void* data) {
         // copy and shift position
         memcpy(tio->data + tio->pos, data, rsz);
         tio->pos += rsz;
+        if (tio->len < tio->pos) tio->len = tio->pos;
 
         return rsz;
+    } else if (tp == Kstr) {
+        // string being built (see 'kstr_builder'), so append in place
+        if (!((kstr)io)->builder) {
+            KTHROW(Kexc, "can't write to a string which isn't being built");
+            return -1;
+        }
+        u8* dst = kstr_reserve((kstr)io, len);
+        if (!dst) return -1;
+        memcpy(dst, data, len);
+        kstr_commit((kstr)io, len);
+
+        return len;
     } else if (tp == Kos_rawio) {
         // C-style write
         kos_rawio tio = (kos_rawio)io;
@@ -485,6 +637,8 @@ kwrite(kobj io, usize len, const void* data) {
         if (rsz < 0) return -1;
 
         return rsz;
+    } else if (tp == Kio_bufio) {
+        return kio_bufio_write((kio_bufio)io, len, data, false);
     } else {
         // TODO: throw error?
         kexit(-1);
@@ -493,115 +647,33 @@ kwrite(kobj io, usize len, const void* data) {
 }
 
 KATA_API ssize
-kwriteu(kobj io, u64 val, s8 base, s32 width) {
-    assert(base >= 2);
-    assert(base <= 16);
-
-    // temporary buffer we populate up to 'i'
-    u8 tmp[100];
-    ssize i = 0;
-
-    // strip out any negative sign
-    bool is_neg = val < 0;
-    if (is_neg) tmp[i++] = '-';
-
-    // emit digits
-    do {
-        // calculate current digit
-        s32 cdig = val % base;
-        if (cdig < 0) cdig = -cdig;
-
-        // now, extract and emit digit
-        val /= base;
-        tmp[i++] = Kdigits[cdig];
-    } while (val > 0);
-
-    // now, reverse buffer
-    ssize j, k;
-    for (j = is_neg?1:0, k = i-1; j < k; j++, k--) {
-        u8 t = tmp[j];
-        tmp[j] = tmp[k];
-        tmp[k] = t;
-    }
-
-    // TODO: zero pad
-    assert(width == 0);
-    return kwrite(io, i, tmp);
-}
-
-KATA_API ssize
-kwrites(kobj io, s64 val, s8 base, s32 width) {
-    assert(2 <= base && base <= 16);
-
-    // temporary buffer we populate up to 'i'
-    u8 tmp[100];
-    ssize i = 0;
-
-    // strip out any negative sign
-    bool is_neg = val < 0;
-    if (is_neg) tmp[i++] = '-';
-
-    // emit digits
-    do {
-        // calculate current digit
-        s32 cdig = val % base;
-        if (cdig < 0) cdig = -cdig;
-
-        // now, extract and emit digit
-        val /= base;
-        tmp[i++] = Kdigits[cdig];
-    } while (val > 0);
-
-    // now, reverse buffer
-    ssize j, k;
-    for (j = is_neg?1:0, k = i-1; j < k; j++, k--) {
-        u8 t = tmp[j];
-        tmp[j] = tmp[k];
-        tmp[k] = t;
+kwriteg(kobj io, usize len, const void* data) {
+    if (KOBJ_TYPE(io) == Kio_bufio) {
+        return kio_bufio_write((kio_bufio)io, len, data, true);
     }
 
-    // TODO: zero pad
-    assert(width == 0);
-    return kwrite(io, i, tmp);
+    return kwrite(io, len, data);
 }
 
-KATA_API ssize
-kwritef(kobj io, f64 val, s8 base, s32 width, s32 prec) {
-
-    // temporary buffer
-    char buf[100];
-    // TODO: solution without libc's snprintf?
-    size_t len = snprintf(buf, sizeof(buf), "%.*lf", (int)F64_DIG, (double)val);
-    assert(len < sizeof(buf) - 1);
-
-    // remove trailing zeros
-    // TODO: make more efficient
-    // TODO: this doesn't work with hex
-    while (len > 2 && buf[len-1] == '0') {
-        // inspect previous character before trailing zero
-        char c = buf[len-2];
-
-        // if is any valid digit
-        if ('0' <= c && c <= '9') {
-        } else if ('a' <= c && c <= 'f') {
-        } else if ('A' <= c && c <= 'F') {
-        } else {
-            // not a valid digit, so we can't continue striping them off
-            break;
-        }
-
-        len--;
+KATA_API keno
+kflush(kobj io) {
+    ktype tp = KOBJ_TYPE(io);
+    if (tp == Kio_bufio) {
+        return kio_bufio_flush((kio_bufio)io);
     }
 
-    assert(width == 0);
-    return kwrite(io, len, buf);
+    // everything else is unbuffered
+    return 0;
 }
 
 KATA_API ssize
 kwriteB(kobj io, kobj obj) {
     ktype tp = KOBJ_TYPE(obj);
     if (tp == Kstr) {
-        return kwrite(io, ((kstr)obj)->lenb, ((kstr)obj)->data);
+        kio_hold(io);
+        ssize res = kwriteg(io, ((kstr)obj)->lenb, KSTR_DATA((kstr)obj));
+        if (kio_release(io) < 0) return -1;
+        return res;
     } else {
         // TODO
         kexit(-1);
@@ -613,7 +685,7 @@ KATA_API ssize
 kwriteS(kobj io, kobj obj) {
     ktype tp = KOBJ_TYPE(obj);
     if (tp == Kstr) {
-        return kwrite(io, ((kstr)obj)->lenb, ((kstr)obj)->data);
+        return kwriteB(io, obj);
     } else if (tp == Kint || tp == Kfloat || tp == Ktuple || tp == Klist || tp == Kdict) {
         return kwriteR(io, obj);
     } else {
@@ -626,7 +698,14 @@ kwriteS(kobj io, kobj obj) {
 KATA_API ssize
 kwriteR(kobj io, kobj obj) {
     ktype tp = KOBJ_TYPE(obj);
-    if (tp->fn_repr != NULL) {
+    if (tp->c_repr != NULL) {
+        // NOTE: the object is alive until this returns, so its data may be borrowed
+        kio_hold(io);
+        ssize res = tp->c_repr(io, obj);
+        if (kio_release(io) < 0) return -1;
+        return res;
+
+    } else if (tp->fn_repr != NULL) {
         kobj res = kqcall(tp->fn_repr, 2, (kobj[]){ obj, io });
         if (!res) return -1;
 
@@ -640,125 +719,6 @@ kwriteR(kobj io, kobj obj) {
         KOBJ_DECREF(res);
         return r;
 
-    } else if (tp == Kstr) {
-        return mywrite_stresc(io, ((kstr)obj)->lenb, ((kstr)obj)->data);
-
-    } else if (tp == Kint) {
-        // TODO: faster ways to dump?
-        size_t len;
-        char* data = bf_ftoa(&len, &((kint)obj)->val, 10, 0, BF_FTOA_FORMAT_FRAC);
-        ssize res = kwrite(io, len, data);
-        kmem_free(data);
-        return res;
-    } else if (tp == Kfloat) {
-        // TODO: faster ways to dump?
-        size_t len;
-        // A few options for modes:
-        // BF_FTOA_FORMAT_FREE: free format, which is exact
-        // BF_FTOA_FORMAT_FREE_MIN: like above, but lowest number of digits
-        //
-        // should 'prec' be taken from the float, the current value, or infinite always?
-        //
-        // TODO: is 'len * bits_per_limb' correct? I assume it must be....
-        s64 prec = ((kfloat)obj)->val.len * LIMB_BITS;
-        char* data = bf_ftoa(&len, &((kfloat)obj)->val, 10, prec, BF_FTOA_FORMAT_FREE_MIN);
-        ssize res = kwrite(io, len, data);
-        kmem_free(data);
-        return res;
-
-    } else if (tp == Ktuple) {
-        ssize rsz = 0, sz = kwrite(io, 1, "(");
-        if (sz < 0) return sz;
-        rsz += sz;
-
-        // emit tuple children
-        ktuple t = (ktuple)obj;
-        usize i;
-        for (i = 0; i < t->len; ++i) {
-            if (i > 0) {
-                sz = kwrite(io, 2, ", ");
-                if (sz < 0) return sz;
-                rsz += sz;
-            }
-        
-            sz = kwriteR(io, t->data[i]);
-            if (sz < 0) return sz;
-            rsz += sz;
-        }
-        // to differentiate from a (...) grouping
-        if (t->len == 1) {
-            sz = kwrite(io, 2, ", ");
-            if (sz < 0) return sz;
-            rsz += sz;
-        }
-
-        sz = kwrite(io, 1, ")");
-        if (sz < 0) return sz;
-        rsz += sz;
-        return rsz;
-
-    } else if (tp == Klist) {
-        // TODO: faster ways to dump?
-        ssize rsz = 0, sz = kwrite(io, 1, "[");
-        if (sz < 0) return sz;
-        rsz += sz;
-
-        // emit list children
-        klist l = (klist)obj;
-        usize i;
-        for (i = 0; i < l->len; ++i) {
-            if (i > 0) {
-                sz = kwrite(io, 2, ", ");
-                if (sz < 0) return sz;
-                rsz += sz;
-            }
-        
-            sz = kwriteR(io, l->data[i]);
-            if (sz < 0) return sz;
-            rsz += sz;
-        }
-
-        sz = kwrite(io, 1, "]");
-        if (sz < 0) return sz;
-        rsz += sz;
-        return rsz;
-
-    } else if (tp == Kdict) {
-        // TODO: faster ways to dump?
-        ssize rsz = 0, sz = kwrite(io, 1, "{");
-        if (sz < 0) return sz;
-        rsz += sz;
-
-        // emit list children
-        kdict d = (kdict)obj;
-
-        usize i, pos;
-        struct kdict_ent* ent;
-        KDICT_ITER(d, ent, i , pos, {
-            if (i > 0) {
-                sz = kwrite(io, 2, ", ");
-                if (sz < 0) return sz;
-                rsz += sz;
-            }
-        
-            sz = kwriteR(io, ent->key);
-            if (sz < 0) return sz;
-            rsz += sz;
-
-            sz = kwrite(io, 2, ": ");
-            if (sz < 0) return sz;
-            rsz += sz;
-
-            sz = kwriteR(io, ent->val);
-            if (sz < 0) return sz;
-            rsz += sz;
-        });
-       
-        sz = kwrite(io, 1, "}");
-        if (sz < 0) return sz;
-        rsz += sz;
-        return rsz;
-
     } else {
         // TODO
         kexit(-1);
@@ -775,8 +735,52 @@ kprintf(kobj io, const char* fmt, ...) {
     return res;
 }
 
-KATA_API ssize
-kprintfv(kobj io, const char* fmt, va_list args) {
+// (internal) write a decimal integer with a precision, which (like C) is the minimum number
+//   of digits, in which case the '0' flag is ignored
+static ssize
+my_printint(kobj io, bool neg, u64 mag, s32 width, s32 prec, u32 flags) {
+    static const char spaces[] = "                ";
+    char sign = neg ? '-' : (flags & KWRITE_PLUS) ? '+' : (flags & KWRITE_SPACE) ? ' ' : 0;
+
+    // NOTE: a zero precision gives no digits for zero
+    s32 n = 0;
+    u64 t = mag;
+    while (t > 0) {
+        n++;
+        t /= 10;
+    }
+    if (n < prec) n = prec;
+    s32 pad = width - n - (sign ? 1 : 0);
+
+    ssize res = 0, sz;
+    while (!(flags & KWRITE_LEFT) && pad > 0) {
+        sz = kwrite(io, pad < 16 ? pad : 16, spaces);
+        if (sz < 0) return sz;
+        res += sz;
+        pad -= sz;
+    }
+    if (sign) {
+        sz = kwrite(io, 1, &sign);
+        if (sz < 0) return sz;
+        res += sz;
+    }
+    if (n > 0) {
+        sz = kwriteu(io, mag, 10, n, KWRITE_ZERO);
+        if (sz < 0) return sz;
+        res += sz;
+    }
+    while (pad > 0) {
+        sz = kwrite(io, pad < 16 ? pad : 16, spaces);
+        if (sz < 0) return sz;
+        res += sz;
+        pad -= sz;
+    }
+    return res;
+}
+
+// (internal) implementation of 'kprintfv', which may borrow data
+static ssize
+my_printfv(kobj io, const char* fmt, va_list args) {
     const char* ofmt = fmt;
     char c;
 
@@ -791,7 +795,7 @@ kprintfv(kobj io, const char* fmt, va_list args) {
         while (*fmt && *fmt != '%') fmt++;
 
         // attempt to write to buffered io
-        sz = kwrite(io, (usize)(fmt - cfmt), cfmt);
+        sz = kwriteg(io, (usize)(fmt - cfmt), cfmt);
         if (sz < 0) return sz;
         rsz += sz;
 
@@ -799,25 +803,17 @@ kprintfv(kobj io, const char* fmt, va_list args) {
             // have a format specifier
             fmt++;
             // width and precision
-            s32 width = 0, prec = 0;
+            // NOTE: 'prec<0' means it wasn't given
+            s32 width = 0, prec = -1;
             bool havePlus = false, haveMinus = false, haveSpace = false, haveZero = false;
 
+            // NOTE: like C, flags may be given in any order, '+' overrides ' ', and '-'
+            //         overrides '0'
             while ((c = *fmt) == '+' || c == '-' || c == ' ' || c == '0') {
-                if (c == '+' || c == ' ' || c == '-') {
-                    if (havePlus || haveMinus || haveSpace) {
-                        fprintf(stderr, "\nERROR: invalid C-style printf format (have multiple +/-/' ') %s\n", ofmt);
-                        kexit(1);
-                    }
-                    if (c == '+') havePlus = true;
-                    if (c == ' ') haveSpace = true;
-                    if (c == '-') haveMinus = true;
-                } else if (c == '0') {
-                    if (haveZero) {
-                        fprintf(stderr, "\nERROR: invalid C-style printf format ('0' given multiple times): %s \n", ofmt);
-                        kexit(1);
-                    }
-                    haveZero = true;
-                }
+                if (c == '+') havePlus = true;
+                else if (c == ' ') haveSpace = true;
+                else if (c == '-') haveMinus = true;
+                else haveZero = true;
                 fmt++;
             }
 
@@ -839,6 +835,7 @@ kprintfv(kobj io, const char* fmt, va_list args) {
             // .<prec>
             if ((c = *fmt) == '.') {
                 fmt++;
+                prec = 0;
                 if ((c = *fmt) == '*') {
                     // -2 means to read in the argument
                     prec = -2;
@@ -852,6 +849,24 @@ kprintfv(kobj io, const char* fmt, va_list args) {
                 }
             }
             
+            // read '*' arguments (where a negative width means to left justify, like C)
+            if (width == -2) {
+                width = va_arg(args, int);
+                if (width < 0) {
+                    haveMinus = true;
+                    width = -width;
+                }
+            }
+            if (prec == -2) {
+                prec = va_arg(args, int);
+                if (prec < 0) prec = -1;
+            }
+
+            if (havePlus) haveSpace = false;
+            if (haveMinus) haveZero = false;
+            u32 flags = (havePlus ? KWRITE_PLUS : 0) | (haveMinus ? KWRITE_LEFT : 0)
+                      | (haveSpace ? KWRITE_SPACE : 0) | (haveZero ? KWRITE_ZERO : 0);
+
             if ((c = *fmt++) == '%') {
                 // literal '%' character
                 sz = kwrite(io, 1, "%");
@@ -859,29 +874,34 @@ kprintfv(kobj io, const char* fmt, va_list args) {
                 rsz += sz;
             } else if (c == 'i') {
                 int val = va_arg(args, int);
-                sz = kwrites(io, val, 10, width);
+                if (prec >= 0) sz = my_printint(io, val < 0, val < 0 ? -(u64)val : (u64)val, width, prec, flags);
+                else sz = kwrites(io, val, 10, width, flags);
                 if (sz < 0) return sz;
                 rsz += sz;
             } else if (c == 'u') {
                 u64 val = va_arg(args, u64);
-                sz = kwriteu(io, val, 10, width);
+                // NOTE: like C, signs are only given for signed conversions
+                flags &= ~(KWRITE_PLUS | KWRITE_SPACE);
+                if (prec >= 0) sz = my_printint(io, false, val, width, prec, flags);
+                else sz = kwriteu(io, val, 10, width, flags);
                 if (sz < 0) return sz;
                 rsz += sz;
             } else if (c == 'v') {
                 s64 val = va_arg(args, s64);
-                sz = kwrites(io, val, 10, width);
+                if (prec >= 0) sz = my_printint(io, val < 0, val < 0 ? -(u64)val : (u64)val, width, prec, flags);
+                else sz = kwrites(io, val, 10, width, flags);
                 if (sz < 0) return sz;
                 rsz += sz;
 
             } else if (c == 'f') {
                 f64 val = va_arg(args, f64);
-                sz = kwritef(io, val, 10, width, prec);
+                sz = kwritef(io, val, 10, width, prec, flags);
                 if (sz < 0) return sz;
                 rsz += sz;
 
             } else if (c == 's') {
                 const char* val = va_arg(args, const char*);
-                sz = kwrite(io, (usize)strlen(val), val);
+                sz = kwriteg(io, (usize)strlen(val), val);
                 if (sz < 0) return sz;
                 rsz += sz;
 
@@ -891,7 +911,7 @@ kprintfv(kobj io, const char* fmt, va_list args) {
                 if (sz < 0) return sz;
                 rsz += sz;
                 
-                sz = kwriteu(io, (u64)val, 16, prec);
+                sz = kwriteu(io, (u64)val, 16, prec > 0 ? prec : 0, KWRITE_ZERO);
                 if (sz < 0) return sz;
                 rsz += sz;
 
@@ -911,7 +931,7 @@ kprintfv(kobj io, const char* fmt, va_list args) {
                 if (sz < 0) return sz;
                 rsz += sz;
 
-                sz = kwriteu(io, (u64)val, 16, -1);
+                sz = kwriteu(io, (u64)val, 16, 0, 0);
                 if (sz < 0) return sz;
                 rsz += sz;
 
@@ -976,3 +996,13 @@ kprintfv(kobj io, const char* fmt, va_list args) {
 
     return rsz;
 }
+
+KATA_API ssize
+kprintfv(kobj io, const char* fmt, va_list args) {
+    // NOTE: the format string and arguments are alive until this returns, so they may be
+    //         borrowed
+    kio_hold(io);
+    ssize res = my_printfv(io, fmt, args);
+    if (kio_release(io) < 0) return -1;
+    return res;
+}
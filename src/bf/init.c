@@ -24,7 +24,15 @@ KATA_API bool
 kbf_const(kobj val, bf_t* obj, bool* dodone) {
 
     ktype tp = KOBJ_TYPE(val);
-    if (tp->bfpos >= 0) {
+    if (tp == Kint && KINT_ISSMALL(val)) {
+        // small integers need to be converted
+        *dodone = true;
+        return kint_getbf((kint)val, obj);
+    } else if (tp == Kint) {
+        *dodone = false;
+        *obj = ((kint)val)->val;
+        return true;
+    } else if (tp->bfpos >= 0) {
         *dodone = false;
         *obj = *(bf_t*)(((usize)val) + tp->bfpos);
         return true;
@@ -39,6 +47,50 @@ kbf_done(bf_t* obj) {
     bf_delete(obj);
 }
 
+KATA_API usize
+kbf_hashs(s64 val) {
+    return kmem_hash(sizeof(val), (const u8*)&val);
+}
+
+KATA_API usize
+kbf_hash(const bf_t* val) {
+    // values that are exactly an 's64' hash like small integers
+    int64_t v;
+    if (bf_is_finite(val) && bf_get_int64(&v, val, BF_RNDZ) == 0) {
+        bf_t t;
+        kbf_init(&t, NULL);
+        bool exact = bf_set_si(&t, v) == 0 && bf_cmp_eq(&t, val);
+        kbf_done(&t);
+        if (exact) return kbf_hashs(v);
+    }
+
+    // otherwise, use the nearest 'f64', which is the same for equal values
+    f64 d;
+    bf_get_float64(val, &d, BF_RNDN);
+    return kmem_hash(sizeof(d), (const u8*)&d);
+}
+
+KATA_API bool
+kbf_eq(kobj a, kobj b, bool* res) {
+    if (!KOBJ_TYPE(b)->is_float) {
+        *res = false;
+        return true;
+    }
+
+    bool doa, dob;
+    bf_t bfa, bfb;
+    if (!kbf_const(a, &bfa, &doa)) return false;
+    if (!kbf_const(b, &bfb, &dob)) {
+        if (doa) kbf_done(&bfa);
+        return false;
+    }
+
+    *res = bf_cmp_eq(&bfa, &bfb);
+    if (doa) kbf_done(&bfa);
+    if (dob) kbf_done(&bfb);
+    return true;
+}
+
 KATA_API void*
 kbf_realloc(void *opaque, void *ptr, size_t sz) {
     if (!sz) {
@@ -0,0 +1,551 @@
+/* src/fmt.c - formatting numbers as text ('kwriteu', 'kwrites', 'kwritef')
+ *
+ * Integers are formatted straight into place, after counting their digits, so there is no
+ *   reversing. Decimal uses a table of digit pairs (one division per 2 digits), and bases
+ *   which are powers of two use shifts and masks
+ *
+ * Floats are written as the shortest decimal that reads back the same (with Ryu), or with a
+ *   fixed number of digits after the point (exactly, with 128-bit integers), falling back to
+ *   libbf for other bases and values too large for either
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+
+/// INTERNALS ///
+
+// size of a field which is built on the stack (wider ones have their padding written separately)
+#define FIELDSZ 128
+
+// pairs of decimal digits, '00' through '99'
+static const char my_dig2[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899"
+;
+
+// powers of 10 which fit in 64 bits
+static const u64 my_pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL,
+};
+
+// (internal) number of digits in 'val', in base 'base'
+static s32
+my_ndig(u64 val, s32 base) {
+    if (val < (u64)base) return 1;
+    s32 bits = 64 - __builtin_clzll(val);
+
+    if (base == 10) {
+        // NOTE: 1233/4096 is just above log10(2), so this is 't' or 't+1' digits
+        s32 t = (bits * 1233) >> 12;
+        return t + 1 - (val < my_pow10[t]);
+    } else if ((base & (base - 1)) == 0) {
+        s32 shift = __builtin_ctz(base);
+        return (bits + shift - 1) / shift;
+    }
+
+    s32 res = 0;
+    do {
+        val /= base;
+        res++;
+    } while (val > 0);
+    return res;
+}
+
+// (internal) write the digits of 'val' in base 'base', ending just before 'end'
+static void
+my_digits(u8* end, u64 val, s32 base) {
+    if (base == 10) {
+        while (val >= 100) {
+            u32 r = val % 100;
+            val /= 100;
+            end -= 2;
+            memcpy(end, my_dig2 + 2 * r, 2);
+        }
+        if (val >= 10) {
+            end -= 2;
+            memcpy(end, my_dig2 + 2 * val, 2);
+        } else {
+            *--end = '0' + val;
+        }
+    } else if ((base & (base - 1)) == 0) {
+        s32 shift = __builtin_ctz(base);
+        u64 mask = base - 1;
+        do {
+            *--end = Kdigits[val & mask];
+            val >>= shift;
+        } while (val > 0);
+    } else {
+        do {
+            *--end = Kdigits[val % base];
+            val /= base;
+        } while (val > 0);
+    }
+}
+
+// (internal) write 'n' copies of 'c', returning the number of bytes written, or <0 on error
+static ssize
+my_fill(kobj io, u8 c, usize n) {
+    u8 tmp[FIELDSZ];
+    memset(tmp, c, n < sizeof(tmp) ? n : sizeof(tmp));
+
+    ssize res = 0;
+    while ((usize)res < n) {
+        usize sz = n - res < sizeof(tmp) ? n - res : sizeof(tmp);
+        ssize wsz = kwrite(io, sz, tmp);
+        if (wsz < 0) return wsz;
+        res += wsz;
+    }
+    return res;
+}
+
+// (internal) write 'sign' (if it isn't 0) and then 'data', padded to 'width' according to 'flags'
+static ssize
+my_field(kobj io, u8 sign, usize len, const u8* data, s32 width, u32 flags) {
+    usize flen = len + (sign != 0);
+    usize pad = width > 0 && (usize)width > flen ? (usize)width - flen : 0;
+
+    // where the padding goes (NOTE: like C, left justifying wins over zero padding)
+    usize lpad = 0, zpad = 0, rpad = 0;
+    if (flags & KWRITE_LEFT) rpad = pad;
+    else if (flags & KWRITE_ZERO) zpad = pad;
+    else lpad = pad;
+
+    if (flen + pad <= FIELDSZ) {
+        // build the whole field, and write it at once
+        u8 tmp[FIELDSZ];
+        u8* p = tmp;
+        memset(p, ' ', lpad);
+        p += lpad;
+        if (sign) *p++ = sign;
+        memset(p, '0', zpad);
+        p += zpad;
+        memcpy(p, data, len);
+        p += len;
+        memset(p, ' ', rpad);
+        p += rpad;
+        return kwrite(io, p - tmp, tmp);
+    }
+
+    // very wide, so write it in pieces
+    ssize res = 0, sz;
+    if ((sz = my_fill(io, ' ', lpad)) < 0) return sz;
+    res += sz;
+    if (sign) {
+        if ((sz = kwrite(io, 1, &sign)) < 0) return sz;
+        res += sz;
+    }
+    if ((sz = my_fill(io, '0', zpad)) < 0) return sz;
+    res += sz;
+    // NOTE: not 'kwriteg', since 'data' may be freed by the caller before a borrow is sent
+    if ((sz = kwrite(io, len, data)) < 0) return sz;
+    res += sz;
+    if ((sz = my_fill(io, ' ', rpad)) < 0) return sz;
+    res += sz;
+    return res;
+}
+
+// (internal) the sign to write for a number, according to 'flags'
+static u8
+my_sign(bool neg, u32 flags) {
+    return neg ? '-' : (flags & KWRITE_PLUS) ? '+' : (flags & KWRITE_SPACE) ? ' ' : 0;
+}
+
+// (internal) write an integer with magnitude 'mag', padded to 'width' according to 'flags'
+static ssize
+my_writeint(kobj io, u64 mag, bool neg, s32 base, s32 width, u32 flags) {
+    assert(2 <= base && base <= 16);
+
+    u8 tmp[64];
+    s32 nd = my_ndig(mag, base);
+    my_digits(tmp + nd, mag, base);
+    return my_field(io, my_sign(neg, flags), nd, tmp, width, flags);
+}
+
+// (internal) 'a * b', as the low half (returned) and the high half ('*hi')
+static u64
+my_umul128(u64 a, u64 b, u64* hi) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (u64)(r >> 64);
+    return (u64)r;
+#else
+    u64 a0 = (u32)a, a1 = a >> 32, b0 = (u32)b, b1 = b >> 32;
+    u64 p00 = a0 * b0, p01 = a0 * b1, p10 = a1 * b0, p11 = a1 * b1;
+    u64 mid = (p00 >> 32) + (u32)p01 + (u32)p10;
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+    return (mid << 32) | (u32)p00;
+#endif
+}
+
+// (internal) '(m * mul) >> j', where 'mul' is 128 bits ({low, high}) and '64 < j < 128'
+static u64
+my_mulshift(u64 m, const u64* mul, s32 j) {
+    u64 hi0, hi1;
+    my_umul128(m, mul[0], &hi0);
+    u64 lo1 = my_umul128(m, mul[1], &hi1);
+    u64 sum = hi0 + lo1;
+    hi1 += sum < hi0;
+    j -= 64;
+    return (hi1 << (64 - j)) | (sum >> j);
+}
+
+// (internal) bit length of '5**e' (for 0 <= e <= 3528)
+static s32
+my_pow5bits(s32 e) {
+    return ((e * 1217359) >> 19) + 1;
+}
+
+// (internal) 'floor(log10(2**e))' (for 0 <= e <= 1650)
+static s32
+my_log10pow2(s32 e) {
+    return (e * 78913) >> 18;
+}
+
+// (internal) 'floor(log10(5**e))' (for 0 <= e <= 2620)
+static s32
+my_log10pow5(s32 e) {
+    return (e * 732923) >> 20;
+}
+
+// (internal) whether 'val' is divisible by '5**p'
+static bool
+my_ispow5(u64 val, s32 p) {
+    s32 n = 0;
+    while (val % 5 == 0) {
+        val /= 5;
+        n++;
+    }
+    return n >= p;
+}
+
+// (internal) get the shortest decimal which reads back as the f64 with bits 'bits' (which is
+//   finite, positive, and non-zero), as '*mant * 10**(*exp)'
+// NOTE: this is the Ryu algorithm, which finds the interval of decimals that round to the value,
+//         and removes digits while the ends of the interval still differ
+// SEE: https://github.com/ulfjack/ryu
+static void
+my_ryu(u64 bits, u64* mant, s32* exp) {
+    u64 ieee_m = bits & ((1ULL << 52) - 1);
+    s32 ieee_e = bits >> 52;
+
+    // value is 'm2 * 2**e2', with 2 extra bits for the interval ends
+    s32 e2;
+    u64 m2;
+    if (ieee_e == 0) {
+        e2 = 1 - 1023 - 52 - 2;
+        m2 = ieee_m;
+    } else {
+        e2 = ieee_e - 1023 - 52 - 2;
+        m2 = (1ULL << 52) | ieee_m;
+    }
+    bool even = (m2 & 1) == 0;
+
+    // the interval is [mv-mmshift-1, mv+2] (scaled by 4), which is closer below at powers of 2
+    u64 mv = 4 * m2;
+    u32 mmshift = ieee_m != 0 || ieee_e <= 1;
+
+    // convert the interval ends to decimal, as 'vm', 'vr', 'vp' times '10**e10'
+    u64 vr, vp, vm;
+    s32 e10;
+    bool vm_zeros = false, vr_zeros = false;
+    if (e2 >= 0) {
+        s32 q = my_log10pow2(e2) - (e2 > 3);
+        s32 k = 125 + my_pow5bits(q) - 1;
+        s32 i = -e2 + q + k;
+        e10 = q;
+        vr = my_mulshift(4 * m2, Kpow5inv[q], i);
+        vp = my_mulshift(4 * m2 + 2, Kpow5inv[q], i);
+        vm = my_mulshift(4 * m2 - 1 - mmshift, Kpow5inv[q], i);
+        if (q <= 21) {
+            // only one of these can be a multiple of 5, if any
+            if (mv % 5 == 0) {
+                vr_zeros = my_ispow5(mv, q);
+            } else if (even) {
+                vm_zeros = my_ispow5(mv - 1 - mmshift, q);
+            } else {
+                vp -= my_ispow5(mv + 2, q);
+            }
+        }
+    } else {
+        s32 q = my_log10pow5(-e2) - (-e2 > 1);
+        s32 i = -e2 - q;
+        s32 k = my_pow5bits(i) - 125;
+        s32 j = q - k;
+        e10 = q + e2;
+        vr = my_mulshift(4 * m2, Kpow5[i], j);
+        vp = my_mulshift(4 * m2 + 2, Kpow5[i], j);
+        vm = my_mulshift(4 * m2 - 1 - mmshift, Kpow5[i], j);
+        if (q <= 1) {
+            // 'mv' has at least 'q' trailing zero bits, so they are all exact
+            vr_zeros = true;
+            if (even) {
+                vm_zeros = mmshift == 1;
+            } else {
+                vp--;
+            }
+        } else if (q < 63) {
+            vr_zeros = (mv & ((1ULL << q) - 1)) == 0;
+        }
+    }
+
+    // remove digits while the interval still has a shorter number in it
+    s32 removed = 0;
+    u32 last = 0;
+    u64 res;
+    if (vm_zeros || vr_zeros) {
+        // rare case, where the ends may be exact
+        while (vp / 10 > vm / 10) {
+            vm_zeros &= vm % 10 == 0;
+            vr_zeros &= last == 0;
+            last = vr % 10;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if (vm_zeros) {
+            while (vm % 10 == 0) {
+                vr_zeros &= last == 0;
+                last = vr % 10;
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        // exactly halfway rounds to even
+        if (vr_zeros && last == 5 && vr % 2 == 0) last = 4;
+        res = vr + ((vr == vm && (!even || !vm_zeros)) || last >= 5);
+    } else {
+        // common case, which removes 2 digits at a time to start with
+        bool up = false;
+        if (vp / 100 > vm / 100) {
+            up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while (vp / 10 > vm / 10) {
+            up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        res = vr + (vr == vm || up);
+    }
+
+    *mant = res;
+    *exp = e10 + removed;
+}
+
+// (internal) write the shortest decimal which reads back as the f64 with bits 'bits' (which is
+//   finite and positive), like Python's 'repr' (i.e. '0.1', '100.0', '1e+16', '1.5e-07')
+static ssize
+my_shortest(kobj io, u8 sign, u64 bits, s32 width, u32 flags) {
+    u64 mant = 0;
+    s32 e10 = 0;
+    if (bits != 0) my_ryu(bits, &mant, &e10);
+
+    u8 dig[20], tmp[40];
+    s32 nd = my_ndig(mant, 10);
+    my_digits(dig + nd, mant, 10);
+
+    // number of digits before the decimal point
+    s32 pt = nd + e10;
+
+    u8* p = tmp;
+    if (pt - 1 < -4 || pt - 1 >= 16) {
+        // scientific notation, with at least 2 digits of exponent
+        *p++ = dig[0];
+        if (nd > 1) {
+            *p++ = '.';
+            memcpy(p, dig + 1, nd - 1);
+            p += nd - 1;
+        }
+        s32 x = pt - 1;
+        *p++ = 'e';
+        *p++ = x < 0 ? '-' : '+';
+        if (x < 0) x = -x;
+        if (x < 10) *p++ = '0';
+        p += my_ndig(x, 10);
+        my_digits(p, x, 10);
+    } else if (pt <= 0) {
+        // '0.000ddd'
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -pt);
+        p += -pt;
+        memcpy(p, dig, nd);
+        p += nd;
+    } else if (pt >= nd) {
+        // 'ddd000.0'
+        memcpy(p, dig, nd);
+        p += nd;
+        memset(p, '0', pt - nd);
+        p += pt - nd;
+        *p++ = '.';
+        *p++ = '0';
+    } else {
+        // 'ddd.ddd'
+        memcpy(p, dig, pt);
+        p += pt;
+        *p++ = '.';
+        memcpy(p, dig + pt, nd - pt);
+        p += nd - pt;
+    }
+
+    return my_field(io, sign, p - tmp, tmp, width, flags);
+}
+
+// (internal) write 'val' (which is finite and positive) in base 'base', with 'prec' digits after
+//   the point (or, if 'prec<0', the fewest digits that read back the same) using libbf
+static ssize
+my_bf(kobj io, u8 sign, f64 val, s32 base, s32 prec, s32 width, u32 flags) {
+    bf_t a;
+    bf_init(&kbf_ctx, &a);
+    if (bf_set_float64(&a, val) != 0) {
+        bf_delete(&a);
+        return -1;
+    }
+
+    size_t len;
+    char* data;
+    if (prec < 0) {
+        data = bf_ftoa(&len, &a, base, 53, BF_FTOA_FORMAT_FREE_MIN);
+    } else {
+        data = bf_ftoa(&len, &a, base, prec, BF_FTOA_FORMAT_FRAC | BF_RNDN);
+    }
+    bf_delete(&a);
+    if (!data) return -1;
+
+    ssize res = my_field(io, sign, len, (const u8*)data, width, flags);
+    kmem_free(data);
+    return res;
+}
+
+// (internal) write the f64 with bits 'bits' (which is finite and positive) in decimal, with
+//   exactly 'prec' digits after the point, correctly rounded (like C's '%.*f')
+static ssize
+my_fixed(kobj io, u8 sign, u64 bits, s32 prec, s32 width, u32 flags) {
+    f64 val;
+    memcpy(&val, &bits, sizeof(val));
+
+#ifdef __SIZEOF_INT128__
+    // value is 'm * 2**e'
+    u64 m = bits & ((1ULL << 52) - 1);
+    s32 e = bits >> 52;
+    if (e == 0) {
+        e = -1074;
+    } else {
+        m |= 1ULL << 52;
+        e -= 1075;
+    }
+
+    // NOTE: the result, 'round(val * 10**prec)', is found exactly with 128-bit integers when
+    //         it fits in 64 bits (which covers most uses), otherwise libbf is used
+    u64 n;
+    bool fast = false;
+    if (prec <= 22 && e >= 0 && e < 11) {
+        // integer, so just add zeros after the point
+        n = m << e;
+        fast = true;
+    } else if (prec <= 22 && e < 0) {
+        unsigned __int128 v = (unsigned __int128)m * my_pow10[prec < 19 ? prec : 19];
+        if (prec > 19) v *= my_pow10[prec - 19];
+
+        // round to nearest, with ties to even
+        s32 s = -e;
+        unsigned __int128 q = 0;
+        if (s < 128) {
+            q = v >> s;
+            unsigned __int128 r = v - (q << s), half = (unsigned __int128)1 << (s - 1);
+            q += r > half || (r == half && (q & 1));
+        }
+        n = (u64)q;
+        fast = (q >> 64) == 0;
+    }
+
+    if (fast) {
+        u8 tmp[64];
+        u8* p = tmp;
+        if (e >= 0) {
+            p += my_ndig(n, 10);
+            my_digits(p, n, 10);
+            if (prec > 0) {
+                *p++ = '.';
+                memset(p, '0', prec);
+                p += prec;
+            }
+        } else {
+            // zeros before the digits, so there is at least one before the point
+            s32 nd = my_ndig(n, 10), nz = nd <= prec ? prec + 1 - nd : 0;
+            memset(p, '0', nz);
+            p += nz;
+            my_digits(p + nd, n, 10);
+
+            // move the digits after the point over
+            s32 ni = nz + nd - prec;
+            if (prec > 0) {
+                memmove(tmp + ni + 1, tmp + ni, prec);
+                tmp[ni] = '.';
+            }
+            p = tmp + ni + (prec > 0 ? prec + 1 : 0);
+        }
+        return my_field(io, sign, p - tmp, tmp, width, flags);
+    }
+#endif
+
+    return my_bf(io, sign, val, 10, prec, width, flags);
+}
+
+
+/// C API ///
+
+KATA_API ssize
+kwriteu(kobj io, u64 val, s8 base, s32 width, u32 flags) {
+    return my_writeint(io, val, false, base, width, flags);
+}
+
+KATA_API ssize
+kwrites(kobj io, s64 val, s8 base, s32 width, u32 flags) {
+    // NOTE: negating as unsigned works for the most negative value, too
+    return my_writeint(io, val < 0 ? -(u64)val : (u64)val, val < 0, base, width, flags);
+}
+
+KATA_API ssize
+kwritef(kobj io, f64 val, s8 base, s32 width, s32 prec, u32 flags) {
+    assert(2 <= base && base <= 16);
+
+    // NOTE: the sign is taken off, so negative zero keeps it
+    u64 bits;
+    memcpy(&bits, &val, sizeof(bits));
+    bool neg = bits >> 63;
+    bits &= ~(1ULL << 63);
+
+    if ((bits >> 52) == 0x7FF) {
+        // infinity and NaN, which (like C) are padded with spaces, not zeros
+        bool isnan = (bits & ((1ULL << 52) - 1)) != 0;
+        return my_field(io, isnan ? 0 : my_sign(neg, flags), 3, (const u8*)(isnan ? "nan" : "inf"), width, flags & ~KWRITE_ZERO);
+    }
+
+    u8 sign = my_sign(neg, flags);
+    if (base != 10) {
+        f64 mag;
+        memcpy(&mag, &bits, sizeof(mag));
+        return my_bf(io, sign, mag, base, prec, width, flags);
+    } else if (prec < 0) {
+        return my_shortest(io, sign, bits, width, flags);
+    } else {
+        return my_fixed(io, sign, bits, prec, width, flags);
+    }
+}
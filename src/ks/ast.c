@@ -7,13 +7,60 @@
 #include <kata/ks.h>
 
 
+/// INTERNALS ///
+
+// (internal) make a tuple from 'arena' (or the heap, if NULL), absorbing references to 'data'
+static ktuple
+my_tuple_newz(struct kmem_arena* arena, usize len, kobj* data) {
+    ktuple obj = kobj_makea(arena, Ktuple, sizeof(struct ktuple) + sizeof(kobj) * len);
+    if (!obj) return NULL;
+
+    obj->len = len;
+    memcpy(obj->data, data, sizeof(kobj) * len);
+    return obj;
+}
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    ks_ast a = (ks_ast)obj;
+    KOBJ_NDECREF(a->tok);
+    KOBJ_DECREF(a->sub);
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    ks_ast a = (ks_ast)obj;
+    switch (a->kind) {
+        // TODO: should VAL even report that its an AST?
+        //case KS_AST_VAL: return kprintf(io, "ks.ast(%R)", a->sub);
+        case KS_AST_VAL: return kprintf(io, "%R", a->sub);
+        case KS_AST_NAME: return kprintf(io, "ks.name(%R)", a->sub);
+        case KS_AST_ADD: return kprintf(io, "ks.add(%J)", a->sub);
+        case KS_AST_SUB: return kprintf(io, "ks.sub(%J)", a->sub);
+        case KS_AST_MUL: return kprintf(io, "ks.mul(%J)", a->sub);
+        case KS_AST_DIV: return kprintf(io, "ks.div(%J)", a->sub);
+        case KS_AST_POW: return kprintf(io, "ks.pow(%J)", a->sub);
+        case KS_AST_CALL: return kprintf(io, "ks.call(%J)", a->sub);
+    }
+
+    return kprintf(io, "ks.ast(%s, %R)", ks_ast_kindname(a->kind), a->sub);
+}
+
 /// C API ///
 
 KTYPE_DECL(Ks_ast);
 
 KATA_API ks_ast
 ks_ast_wrapx(ks_tok tok, u32 kind, kobj sub) {
-    ks_ast obj = kobj_make(Ks_ast);
+    return ks_ast_wrapxa(NULL, tok, kind, sub);
+}
+
+KATA_API ks_ast
+ks_ast_wrapxa(struct kmem_arena* arena, ks_tok tok, u32 kind, kobj sub) {
+    ks_ast obj = kobj_makea(arena, Ks_ast, sizeof(struct ks_ast));
     if (!obj) return NULL;
 
     obj->kind = kind;
@@ -44,6 +91,11 @@ ks_ast_new(ks_tok tok, u32 kind, int nsub, kobj* sub) {
 
 KATA_API ks_ast
 ks_ast_newz(ks_tok tok, u32 kind, int nsub, kobj* sub) {
+    return ks_ast_newza(NULL, tok, kind, nsub, sub);
+}
+
+KATA_API ks_ast
+ks_ast_newza(struct kmem_arena* arena, ks_tok tok, u32 kind, int nsub, kobj* sub) {
 
     // check for any NULLs and error out if thats the case
     int i;
@@ -56,13 +108,13 @@ ks_ast_newz(ks_tok tok, u32 kind, int nsub, kobj* sub) {
         }
     }
 
-    ks_ast obj = kobj_make(Ks_ast);
+    ks_ast obj = kobj_makea(arena, Ks_ast, sizeof(struct ks_ast));
     if (!obj) return NULL;
 
     obj->kind = kind;
     KOBJ_NINCREF(tok);
     obj->tok = tok;
-    obj->sub = ktuple_newz(nsub, sub);
+    obj->sub = (kobj)my_tuple_newz(arena, nsub, sub);
 
     return obj;
 }
@@ -88,10 +140,8 @@ ks_ast_kindname(u32 kind) {
 static KCFUNC(ks_ast_del_) {
     ks_ast obj;
     KARGS("obj:!", &obj, Ks_ast);
-    
-    KOBJ_NDECREF(obj->tok);
-    KOBJ_DECREF(obj->sub);
-    kobj_del(obj);
+
+    my_del((kobj)obj);
     return NULL;
 }
 
@@ -100,21 +150,7 @@ static KCFUNC(ks_ast_repr_) {
     kobj io;
     KARGS("obj:! io", &obj, Ks_ast, &io);
 
-    switch (obj->kind) {
-        // TODO: should VAL even report that its an AST?
-        //case KS_AST_VAL: return krrv(kprintf(io, "ks.ast(%R)", obj->sub));
-        case KS_AST_VAL: return krrv(kprintf(io, "%R", obj->sub));
-        case KS_AST_NAME: return krrv(kprintf(io, "ks.name(%R)", obj->sub));
-        case KS_AST_ADD: return krrv(kprintf(io, "ks.add(%J)", obj->sub));
-        case KS_AST_SUB: return krrv(kprintf(io, "ks.sub(%J)", obj->sub));
-        case KS_AST_MUL: return krrv(kprintf(io, "ks.mul(%J)", obj->sub));
-        case KS_AST_DIV: return krrv(kprintf(io, "ks.div(%J)", obj->sub));
-        case KS_AST_POW: return krrv(kprintf(io, "ks.pow(%J)", obj->sub));
-        case KS_AST_CALL: return krrv(kprintf(io, "ks.call(%J)", obj->sub));
-    }
-
-    return krrv(kprintf(io, "ks.ast(%s, %R)", ks_ast_kindname(obj->kind), obj->sub));
-
+    return krrv(my_repr(io, (kobj)obj));
 }
 
 KATA_API void
@@ -126,4 +162,7 @@ kinit_ks_ast() {
         { "__repr", (kobj)kfunc_new(ks_ast_repr_, "ks.ast.__repr(obj: ks.ast, io)", "") },
     ));
 
+    Ks_ast->c_del = my_del;
+    Ks_ast->c_repr = my_repr;
+
 }
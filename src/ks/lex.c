@@ -60,8 +60,16 @@ myis_name(kucp c) {
 
 KATA_API s32
 ks_lex(kstr filename, kstr src, ks_tok** ptoks) {
+    return ks_lexa(filename, src, ptoks, NULL);
+}
+
+KATA_API s32
+ks_lexa(kstr filename, kstr src, ks_tok** ptoks, struct kmem_arena* arena) {
     s32 res = 0, res_max = 0;
 
+    // make sure the source is contiguous, since it is read byte by byte
+    KSTR_DATA(src);
+
     // DO NOT OVERWRITE THESE, they are used in 'ADV()'
     s32 i = 0, line = 0, col = 0;
 
@@ -84,7 +92,7 @@ ks_lex(kstr filename, kstr src, ks_tok** ptoks) {
 
     // emit a token, given the kind
     #define EMIT(kind_) do { \
-        ks_tok tok = ks_tok_new((kind_), i_start, i - i_start, line_start, col_start, col - col_start); \
+        ks_tok tok = ks_tok_newa(arena, (kind_), i_start, i - i_start, line_start, col_start, col - col_start); \
         if (!tok) return -1; \
         s32 newres = res + 1; \
         if (newres > res_max) { \
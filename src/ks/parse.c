@@ -159,14 +159,14 @@
 
 
 // helper macro to define a C-style rule function
-#define RULE(name_) static ks_ast name_(kstr filename, kstr src, s32 ntoks, ks_tok* toks, s32* ptoki)
+#define RULE(name_) static ks_ast name_(kstr filename, kstr src, s32 ntoks, ks_tok* toks, s32* ptoki, struct kmem_arena* arena)
 
 // helper macro to define a C-style bool rule function, returns whether it matched or
 //   not (NOTE: this does not throw an error !)
-#define BOOLRULE(name_) static bool name_(kstr filename, kstr src, s32 ntoks, ks_tok* toks, s32* ptoki)
+#define BOOLRULE(name_) static bool name_(kstr filename, kstr src, s32 ntoks, ks_tok* toks, s32* ptoki, struct kmem_arena* arena)
 
 // helper macro to match the given rule
-#define MATCH(name_) name_(filename, src, ntoks, toks, ptoki)
+#define MATCH(name_) name_(filename, src, ntoks, toks, ptoki, arena)
 
 // helper macro for the current token index
 #define TOKI (*ptoki)
@@ -244,7 +244,7 @@ RULE(B) {
             }
         }
 
-        ks_ast res = ks_ast_newz(tok, KS_AST_BLOCK, hb_n, hb);
+        ks_ast res = ks_ast_newza(arena, tok, KS_AST_BLOCK, hb_n, hb);
         hb_n = 0;
         HBUF_CLEAR(hb);
         return res;
@@ -278,7 +278,7 @@ RULE(STMT) {
         // 'import' NAME N
         TOKI++;
 
-        ks_ast res = ks_ast_newz(LAST, KS_AST_IMPORT, 1, (kobj[]){ (kobj)MATCH(NAME) });
+        ks_ast res = ks_ast_newza(arena, LAST, KS_AST_IMPORT, 1, (kobj[]){ (kobj)MATCH(NAME) });
         if (!res) {
             return NULL;
         }
@@ -294,10 +294,10 @@ RULE(STMT) {
 
         if (MATCH(N)) {
             // just do none
-            return ks_ast_newz(LAST, KS_AST_RET, 0, NULL);
+            return ks_ast_newza(arena, LAST, KS_AST_RET, 0, NULL);
         } else {
             // parse an expression to return
-            ks_ast res = ks_ast_newz(LAST, KS_AST_RET, 1, (kobj[]){ (kobj)MATCH(EXPR) });
+            ks_ast res = ks_ast_newza(arena, LAST, KS_AST_RET, 1, (kobj[]){ (kobj)MATCH(EXPR) });
             if (!res) return NULL;
             
             // now, we need to match an end
@@ -314,10 +314,10 @@ RULE(STMT) {
 
         if (MATCH(N)) {
             // just do none
-            return ks_ast_newz(tok, KS_AST_THROW, 0, NULL);
+            return ks_ast_newza(arena, tok, KS_AST_THROW, 0, NULL);
         } else {
             // parse an expression to return
-            ks_ast res = ks_ast_newz(tok, KS_AST_THROW, 1, (kobj[]){ (kobj)MATCH(EXPR) });
+            ks_ast res = ks_ast_newza(arena, tok, KS_AST_THROW, 1, (kobj[]){ (kobj)MATCH(EXPR) });
             if (!res) return NULL;
             
             // now, we need to match an end
@@ -380,7 +380,7 @@ RULE(STMT) {
             // number to take, on the first time also take the 'else' clause 
             int num = hb_n % 2 == 1 ? 3 : 2;
             hb_n -= num;
-            res = ks_ast_newz(NULL, KS_AST_IF, num, hb + hb_n);
+            res = ks_ast_newza(arena, NULL, KS_AST_IF, num, hb + hb_n);
             if (!res) {
                 HBUF_CLEAR(hb);
                 return NULL;
@@ -444,7 +444,7 @@ RULE(E12) {
                 KOBJ_DECREF(res);
                 return NULL;
             }
-            res = ks_ast_newz(LAST, KS_AST_ATTR, 2, (kobj[]){ (kobj)res, (kobj)kstr_new(LAST->lenb, src->data + LAST->posb) });
+            res = ks_ast_newza(arena, LAST, KS_AST_ATTR, 2, (kobj[]){ (kobj)res, (kobj)kstr_intern(LAST->lenb, (const char*)src->data + LAST->posb) });
             TOKI++;
             break;
         case KS_TOK_LPAR:
@@ -480,7 +480,7 @@ RULE(E12) {
             TOKI++;
 
             // now, construct tree
-            res = ks_ast_newz(LAST, KS_AST_CALL, hb_n, hb);
+            res = ks_ast_newza(arena, LAST, KS_AST_CALL, hb_n, hb);
             hb_n = 0;
             HBUF_CLEAR(hb);
             return res;
@@ -504,7 +504,7 @@ RULE(E10) {
         {
         case KS_TOK_UP:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_POW, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
+            res = ks_ast_newza(arena, LAST, KS_AST_POW, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
             break;
         default:
             return res;
@@ -521,23 +521,23 @@ RULE(E9) {
         {
         case KS_TOK_STAR:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_MUL, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
+            res = ks_ast_newza(arena, LAST, KS_AST_MUL, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
             break;
         case KS_TOK_SLASH:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_DIV, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
+            res = ks_ast_newza(arena, LAST, KS_AST_DIV, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
             break;
         case KS_TOK_SLASHSLASH:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_FLOORDIV, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
+            res = ks_ast_newza(arena, LAST, KS_AST_FLOORDIV, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
             break;
         case KS_TOK_PERC:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_MOD, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
+            res = ks_ast_newza(arena, LAST, KS_AST_MOD, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
             break;
         case KS_TOK_AT:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_MATMUL, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
+            res = ks_ast_newza(arena, LAST, KS_AST_MATMUL, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E10) });
             break;
 
         default:
@@ -555,11 +555,11 @@ RULE(E8) {
         {
         case KS_TOK_PLUS:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_ADD, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E9) });
+            res = ks_ast_newza(arena, LAST, KS_AST_ADD, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E9) });
             break;
         case KS_TOK_MINUS:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_SUB, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E9) });
+            res = ks_ast_newza(arena, LAST, KS_AST_SUB, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E9) });
             break;
 
         default:
@@ -581,40 +581,40 @@ RULE(E1) {
         {
         case KS_TOK_EQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_EQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_EQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
         case KS_TOK_PLUSEQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_ADDEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_ADDEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
         case KS_TOK_MINUSEQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_SUBEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_SUBEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
 
         case KS_TOK_STAREQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_MULEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_MULEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
 
         case KS_TOK_SLASHEQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_DIVEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_DIVEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
 
         case KS_TOK_PERCEQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_MODEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_MODEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
 
         case KS_TOK_UPEQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_POWEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_POWEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
         
         case KS_TOK_ATEQ:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_MATMULEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
+            res = ks_ast_newza(arena, LAST, KS_AST_MATMULEQ, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E2) });
             break;
         default:
             return res;
@@ -632,11 +632,11 @@ RULE(E0) {
         {
         case KS_TOK_PIPE:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_PIPE, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E1) });
+            res = ks_ast_newza(arena, LAST, KS_AST_PIPE, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E1) });
             break;
         case KS_TOK_AND:
             TOKI++;
-            res = ks_ast_newz(LAST, KS_AST_AND, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E1) });
+            res = ks_ast_newza(arena, LAST, KS_AST_AND, 2, (kobj[]){ (kobj)res, (kobj)MATCH(E1) });
             break;
         
         default:
@@ -674,7 +674,8 @@ RULE(ATOM) {
 RULE(NAME) {
     if (TOK->kind == KS_TOK_NAME) {
         TOKI++;
-        return ks_ast_wrapx(LAST, KS_AST_NAME, (kobj)kstr_new(LAST->lenb, src->data + LAST->posb));
+        // NOTE: names are interned, which are never freed (see 'kstr_intern')
+        return ks_ast_wrapxa(arena, LAST, KS_AST_NAME, (kobj)kstr_intern(LAST->lenb, (const char*)src->data + LAST->posb));
     } else {
         printf("GOT: %i\n", TOK->kind);
         assert(false);
@@ -690,7 +691,7 @@ RULE(INT) {
         kint v = kint_new(s->data, 10);
         assert(v != NULL);
         KOBJ_DECREF(s);
-        ks_ast res = ks_ast_wrap(LAST, (kobj)v);
+        ks_ast res = ks_ast_wrapxa(arena, LAST, KS_AST_VAL, (kobj)v);
         return res;
     } else {
         printf("GOT: %i\n", TOK->kind);
@@ -707,7 +708,7 @@ RULE(FLOAT) {
         kfloat v = kfloat_new(s->data, 10, -1);
         assert(v != NULL);
         KOBJ_DECREF(s);
-        ks_ast res = ks_ast_wrap(LAST, (kobj)v);
+        ks_ast res = ks_ast_wrapxa(arena, LAST, KS_AST_VAL, (kobj)v);
         return res;
     } else {
         printf("GOT: %i\n", TOK->kind);
@@ -719,9 +720,17 @@ RULE(FLOAT) {
 
 KATA_API ks_ast
 ks_parse(kstr filename, kstr src, s32* pntoks, ks_tok** ptoks) {
+    return ks_parsea(filename, src, pntoks, ptoks, NULL);
+}
+
+KATA_API ks_ast
+ks_parsea(kstr filename, kstr src, s32* pntoks, ks_tok** ptoks, struct kmem_arena* arena) {
+    // make sure the source is contiguous, since tokens refer to it by position
+    KSTR_DATA(src);
+
     // tokenize as needed
     if (*pntoks <= 0) {
-        *pntoks = ks_lex(filename, src, ptoks);
+        *pntoks = ks_lexa(filename, src, ptoks, arena);
         if (*pntoks < 0) {
             return NULL;
         }
@@ -742,7 +751,7 @@ ks_parse(kstr filename, kstr src, s32* pntoks, ks_tok** ptoks) {
     return res;
 
     /*
-    return ks_ast_newz(KS_AST_NAME, 1, (kobj[]) {
+    return ks_ast_newza(arena, KS_AST_NAME, 1, (kobj[]) {
         (kobj)kstr_new(-1, "asdf"),
     });
     */
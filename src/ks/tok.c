@@ -6,6 +6,15 @@
 #include <kata/impl.h>
 #include <kata/ks.h>
 
+/// INTERNALS ///
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    ks_tok t = (ks_tok)obj;
+    return kprintf(io, "ks.tok(%v, %v)", (s64)t->posb, (s64)t->lenb);
+}
+
 
 /// C API ///
 
@@ -13,7 +22,12 @@ KTYPE_DECL(Ks_tok);
 
 KATA_API ks_tok
 ks_tok_new(s32 kind, s32 posb, s32 lenb, s32 line, s32 col, s32 lenc) {
-    ks_tok obj = kobj_make(Ks_tok);
+    return ks_tok_newa(NULL, kind, posb, lenb, line, col, lenc);
+}
+
+KATA_API ks_tok
+ks_tok_newa(struct kmem_arena* arena, s32 kind, s32 posb, s32 lenb, s32 line, s32 col, s32 lenc) {
+    ks_tok obj = kobj_makea(arena, Ks_tok, sizeof(struct ks_tok));
     if (!obj) return NULL;
     
     obj->kind = kind;
@@ -33,7 +47,7 @@ static KCFUNC(ks_tok_repr_) {
     kobj io;
     KARGS("obj:! io", &obj, Ks_tok, &io);
 
-    return krrv(kprintf(io, "ks.tok(%v, %v)", (s64)obj->posb, (s64)obj->lenb));
+    return krrv(my_repr(io, (kobj)obj));
 }
 
 KATA_API void
@@ -43,4 +57,6 @@ kinit_ks_tok() {
     ktype_merge(Ks_tok, KDICT_IKV(
         { "__repr", (kobj)kfunc_new(ks_tok_repr_, "ks.tok.__repr(obj: ks.tok, io)", "") },
     ));
+
+    Ks_tok->c_repr = my_repr;
 }
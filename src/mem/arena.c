@@ -0,0 +1,112 @@
+/* src/mem/arena.c - region/arena allocator, for many blocks which share a lifetime
+ *
+ * an arena hands out blocks by bumping a pointer through large chunks, and releases
+ *   all of them at once (or all of them made after a given mark). chunks are aligned
+ *   to KMEM_SLAB_SZ, and recorded in the page map (see 'src/mem/slab.c'), so that
+ *   'kmem_free' on an arena block is a no-op instead of an error. this means objects
+ *   can be made in an arena (see 'kobj_makea') and still be decref'd as usual, the
+ *   memory just isn't reused until the arena is reset
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+/// INTERNALS ///
+
+// alignment of blocks, in bytes
+#define ALIGN 16
+
+// header stored at the start of every chunk
+struct kmem_arena_chunk {
+
+    // the previously allocated chunk
+    struct kmem_arena_chunk* prev;
+
+    // size of the chunk, in bytes
+    usize sz;
+
+};
+
+// size of the chunk header, rounded so that blocks stay aligned
+#define CHUNK_HDR (((sizeof(struct kmem_arena_chunk) + ALIGN - 1) / ALIGN) * ALIGN)
+
+// (internal) add a chunk to an arena, with room for at least 'sz' bytes
+static bool
+my_chunk_new(struct kmem_arena* arena, usize sz) {
+    // round up to a multiple of the chunk size
+    usize csz = ((CHUNK_HDR + sz + KMEM_SLAB_SZ - 1) / KMEM_SLAB_SZ) * KMEM_SLAB_SZ;
+
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, KMEM_SLAB_SZ, csz) != 0) return false;
+    if (!kmem_pmap_set(ptr, csz, KMEM_CHUNK_ARENA)) {
+        free(ptr);
+        return false;
+    }
+
+    struct kmem_arena_chunk* chunk = ptr;
+    chunk->prev = arena->chunk;
+    chunk->sz = csz;
+
+    arena->chunk = chunk;
+    arena->cur = (u8*)chunk + CHUNK_HDR;
+    arena->end = (u8*)chunk + csz;
+    return true;
+}
+
+// (internal) release the newest chunk of an arena
+static void
+my_chunk_del(struct kmem_arena* arena) {
+    struct kmem_arena_chunk* chunk = arena->chunk;
+    arena->chunk = chunk->prev;
+
+    kmem_pmap_set(chunk, chunk->sz, KMEM_CHUNK_NONE);
+    free(chunk);
+}
+
+
+/// C API ///
+
+KATA_API void
+kmem_arena_init(struct kmem_arena* arena) {
+    arena->chunk = NULL;
+    arena->cur = arena->end = NULL;
+}
+
+KATA_API void
+kmem_arena_done(struct kmem_arena* arena) {
+    while (arena->chunk) my_chunk_del(arena);
+    arena->cur = arena->end = NULL;
+}
+
+KATA_API void*
+kmem_arena_make(struct kmem_arena* arena, usize sz) {
+    if (!sz) return NULL;
+    sz = ((sz + ALIGN - 1) / ALIGN) * ALIGN;
+
+    if (arena->cur + sz > arena->end) {
+        if (!my_chunk_new(arena, sz)) return NULL;
+    }
+
+    void* res = arena->cur;
+    arena->cur += sz;
+    return res;
+}
+
+KATA_API struct kmem_arena_mark
+kmem_arena_mark(struct kmem_arena* arena) {
+    return (struct kmem_arena_mark){ arena->chunk, arena->cur };
+}
+
+KATA_API void
+kmem_arena_reset(struct kmem_arena* arena, struct kmem_arena_mark mark) {
+    // release chunks made after the mark
+    while (arena->chunk != mark.chunk) my_chunk_del(arena);
+
+    if (arena->chunk) {
+        arena->cur = mark.cur;
+        arena->end = (u8*)arena->chunk + arena->chunk->sz;
+    } else {
+        arena->cur = arena->end = NULL;
+    }
+}
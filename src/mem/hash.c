@@ -0,0 +1,193 @@
+/* src/mem/hash.c - fast 64-bit hashing of memory (see 'kmem_hash')
+ *
+ * the hash is in the style of wyhash: input is read 32 bytes per step, as two independent
+ *   16-byte lanes, each of which is mixed in with a single 64x64->128 bit multiply (folding
+ *   the high and low halves together). the remaining 0-31 bytes are mixed the same way, and
+ *   the total length is mixed in last
+ *
+ * since blocks are always 32 bytes (regardless of how input is split up), the streaming
+ *   hasher ('kmem_hasher_*') just keeps a partial block buffered, and always gives the same
+ *   result as 'kmem_hash' on the concatenated input
+ *
+ * SEE: https://github.com/wangyi-fudan/wyhash
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+/// INTERNALS ///
+
+// secret constants, which are odd and have balanced bits
+#define S0 0xa0761d6478bd642full
+#define S1 0xe7037ed1a0b428dbull
+#define S2 0x8ebc6af09c88c6e3ull
+#define S3 0x589965cc75374cc3ull
+
+// (internal) multiply, and fold the 128 bit result into 64 bits
+static inline u64
+my_mix(u64 a, u64 b) {
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = (__uint128_t)a * b;
+    return (u64)r ^ (u64)(r >> 64);
+#else
+    // portable version, for targets without 128 bit integers
+    u64 ha = a >> 32, hb = b >> 32, la = (u32)a, lb = (u32)b;
+    u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    u64 t = rl + (rm0 << 32), c = t < rl;
+    u64 lo = t + (rm1 << 32);
+    c += lo < t;
+    u64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+// (internal) read a 64 bit word, which may be unaligned
+static inline u64
+my_r64(const u8* p) {
+    u64 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// (internal) read a 32 bit word, which may be unaligned
+static inline u64
+my_r32(const u8* p) {
+    u32 v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// (internal) mix in a full 32 byte block
+static inline void
+my_block(u64* s0, u64* s1, const u8* p) {
+    *s0 = my_mix(my_r64(p +  0) ^ S0, my_r64(p +  8) ^ *s0);
+    *s1 = my_mix(my_r64(p + 16) ^ S1, my_r64(p + 24) ^ *s1);
+}
+
+// (internal) mix in the last (partial) block, and the total length
+// NOTE: the remaining bytes are read with overlapping words instead of padding, which is
+//         still unambiguous since the length is mixed in as well
+static inline u64
+my_final(u64 s0, u64 s1, usize nrem, const u8* rem, u64 len) {
+    u64 h = s0 ^ s1, a, b;
+    if (nrem > 16) {
+        h = my_mix(my_r64(rem) ^ S2, my_r64(rem + 8) ^ h);
+        a = my_r64(rem + nrem - 16);
+        b = my_r64(rem + nrem - 8);
+    } else if (nrem >= 8) {
+        a = my_r64(rem);
+        b = my_r64(rem + nrem - 8);
+    } else if (nrem >= 4) {
+        a = my_r32(rem);
+        b = my_r32(rem + nrem - 4);
+    } else if (nrem > 0) {
+        a = ((u64)rem[0] << 16) | ((u64)rem[nrem >> 1] << 8) | rem[nrem - 1];
+        b = 0;
+    } else {
+        a = b = 0;
+    }
+
+    h = my_mix(a ^ S3, b ^ h);
+    return my_mix(h ^ S0, len ^ S3);
+}
+
+// (internal) whether a 64 bit word contains a zero byte
+#define HASZERO(v_) (((v_) - 0x0101010101010101ull) & ~(v_) & 0x8080808080808080ull)
+
+
+/// C API ///
+
+KATA_API usize
+kmem_hash(usize len, const u8* data) {
+    u64 s0 = S0, s1 = S1;
+    usize i = 0;
+    for (; i + 32 <= len; i += 32) {
+        my_block(&s0, &s1, data + i);
+    }
+    return (usize)my_final(s0, s1, len - i, data + i, len);
+}
+
+// NOTE: word reads may go past the NUL-terminator (but never past the aligned word it
+//         is in, so never into another page), which address sanitizers complain about
+#ifdef __GNUC__
+__attribute__((no_sanitize_address))
+#endif
+KATA_API usize
+kmem_hashz(const char* str, usize* len) {
+    const u8* data = (const u8*)str;
+    u64 s0 = S0, s1 = S1;
+
+    // the current (partial) block, which starts at 'data + i'
+    usize i = 0, j = 0;
+
+    // scan bytewise until aligned, so that word reads never cross a page
+    while (((uintptr_t)(data + j)) % 8 != 0) {
+        if (!data[j]) goto done;
+        j++;
+    }
+
+    // scan a word at a time, mixing in full blocks as they are found
+    while (true) {
+        u64 w;
+        memcpy(&w, data + j, sizeof(w));
+        if (HASZERO(w)) break;
+        j += 8;
+        if (j - i >= 32) {
+            my_block(&s0, &s1, data + i);
+            i += 32;
+        }
+    }
+
+    // find the exact end in the last word
+    while (data[j]) j++;
+
+  done:
+    // mix in any remaining full blocks, since the bytewise scan doesn't
+    for (; i + 32 <= j; i += 32) {
+        my_block(&s0, &s1, data + i);
+    }
+
+    if (len) *len = j;
+    return (usize)my_final(s0, s1, j - i, data + i, j);
+}
+
+KATA_API void
+kmem_hasher_init(struct kmem_hasher* hs) {
+    hs->s0 = S0;
+    hs->s1 = S1;
+    hs->len = 0;
+}
+
+KATA_API void
+kmem_hasher_update(struct kmem_hasher* hs, usize len, const u8* data) {
+    usize nbuf = hs->len % 32;
+    hs->len += len;
+
+    // first, fill up a partial block
+    if (nbuf > 0) {
+        usize n = 32 - nbuf;
+        if (n > len) n = len;
+        memcpy(hs->buf + nbuf, data, n);
+        data += n;
+        len -= n;
+        nbuf += n;
+        if (nbuf < 32) return;
+        my_block(&hs->s0, &hs->s1, hs->buf);
+    }
+
+    // then, full blocks straight from the input
+    while (len >= 32) {
+        my_block(&hs->s0, &hs->s1, data);
+        data += 32;
+        len -= 32;
+    }
+
+    // keep the rest for later
+    memcpy(hs->buf, data, len);
+}
+
+KATA_API usize
+kmem_hasher_final(struct kmem_hasher* hs) {
+    return (usize)my_final(hs->s0, hs->s1, hs->len % 32, hs->buf, hs->len);
+}
@@ -0,0 +1,98 @@
+/* src/mem/huge.c - huge block allocator, used by 'kmem_make' for very large blocks
+ *
+ * huge blocks (>= KMEM_HUGE_MIN bytes) are mapped straight from the OS instead of coming
+ *   from the C library. this means growing them can move pages around (with 'mremap')
+ *   instead of copying their contents, and freeing them gives the memory back to the OS
+ *   right away
+ *
+ * like C library blocks, huge blocks have a 'struct kmem_big' header in front of them, but
+ *   with 'map' set to the size of the mapping (which includes the header)
+ *
+ * NOTE: on systems without 'mremap', growing falls back to mapping a new region and copying
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+// for 'mremap'
+#define _GNU_SOURCE
+
+#include <kata/impl.h>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+/// INTERNALS ///
+
+// size of a transparent huge page, which is the minimum mapping to advise them for
+#define THP_SZ (2 * 1024 * 1024)
+
+// (internal) round up to a multiple of the page size
+static usize
+my_round(usize sz) {
+    static usize pgsz = 0;
+    if (!pgsz) pgsz = sysconf(_SC_PAGESIZE);
+    return ((sz + pgsz - 1) / pgsz) * pgsz;
+}
+
+// (internal) advise the OS to back a mapping with huge pages, if possible
+static void
+my_advise(void* ptr, usize sz) {
+#ifdef MADV_HUGEPAGE
+    if (sz >= THP_SZ) madvise(ptr, sz, MADV_HUGEPAGE);
+#endif
+}
+
+
+/// C API ///
+
+KATA_API void*
+kmem_huge_make(usize sz) {
+    usize map = my_round(sizeof(struct kmem_big) + sz);
+    void* ptr = mmap(NULL, map, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return NULL;
+    my_advise(ptr, map);
+
+    struct kmem_big* big = ptr;
+    big->sz = sz;
+    big->map = map;
+    return big + 1;
+}
+
+KATA_API bool
+kmem_huge_grow(void** pptr, usize sz) {
+    struct kmem_big* big = ((struct kmem_big*)*pptr) - 1;
+    assert(big->map > 0);
+
+    // may already have enough room in the mapping
+    usize map = my_round(sizeof(struct kmem_big) + sz);
+    if (map <= big->map) {
+        big->sz = sz;
+        return true;
+    }
+
+#ifdef MREMAP_MAYMOVE
+    // move (or extend) the pages, without copying
+    void* ptr = mremap(big, big->map, map, MREMAP_MAYMOVE);
+    if (ptr == MAP_FAILED) return false;
+    my_advise(ptr, map);
+#else
+    void* ptr = mmap(NULL, map, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ptr == MAP_FAILED) return false;
+    my_advise(ptr, map);
+    memcpy(ptr, big, sizeof(*big) + big->sz);
+    munmap(big, big->map);
+#endif
+
+    big = ptr;
+    big->sz = sz;
+    big->map = map;
+    *pptr = big + 1;
+    return true;
+}
+
+KATA_API void
+kmem_huge_free(void* ptr) {
+    struct kmem_big* big = ((struct kmem_big*)ptr) - 1;
+    assert(big->map > 0);
+    munmap(big, big->map);
+}
@@ -71,8 +71,33 @@ KATA_API void*
 kmem_make(usize sz) {
     // special case, no allocation but also no failure
     if (!sz) return NULL;
-    // use C library
-    return malloc(sz);
+    void* res;
+    if (sz <= KMEM_SLAB_MAX) {
+        // small blocks come from slabs (see 'src/mem/slab.c')
+        res = kmem_slab_make(sz);
+        if (!res) return NULL;
+#if KATA_MEM_STATS
+        kmem_stats_onmake(kmem_slab_sizeof(res));
+#endif
+        return res;
+    }
+
+    if (sz >= KMEM_HUGE_MIN) {
+        // huge blocks are mapped from the OS (see 'src/mem/huge.c')
+        res = kmem_huge_make(sz);
+        if (!res) return NULL;
+    } else {
+        // use C library, with a header to remember the size
+        struct kmem_big* big = malloc(sizeof(*big) + sz);
+        if (!big) return NULL;
+        big->sz = sz;
+        big->map = 0;
+        res = big + 1;
+    }
+#if KATA_MEM_STATS
+    kmem_stats_onmake(sz);
+#endif
+    return res;
 }
 
 KATA_API bool
@@ -83,15 +108,51 @@ kmem_grow(void** pptr, usize sz) {
         *pptr = kmem_make(sz);
         return *pptr != NULL;
     }
-    // use C library, and check return... this should behave
-    //   like this on WASM at least
-    void* newptr = realloc(*pptr, sz);
-    if (!newptr) {
-        // error
-        return false;
+    u8 kind = kmem_pmap_get(*pptr);
+    assert(kind != KMEM_CHUNK_ARENA);
+    if (kind == KMEM_CHUNK_SLAB) {
+        // slab blocks can't be resized, but may already have enough room
+        usize osz = kmem_slab_sizeof(*pptr);
+        if (osz >= sz) return true;
+
+        void* newptr = kmem_make(sz);
+        if (!newptr) return false;
+
+        memcpy(newptr, *pptr, osz);
+        kmem_free(*pptr);
+        *pptr = newptr;
+        return true;
     }
 
-    *pptr = newptr;
+    struct kmem_big* big = ((struct kmem_big*)*pptr) - 1;
+    usize osz = big->sz;
+    if (big->map) {
+        // huge blocks can be grown without copying
+        if (!kmem_huge_grow(pptr, sz)) return false;
+    } else if (sz >= KMEM_HUGE_MIN) {
+        // becoming a huge block, which is the last time it is copied
+        void* newptr = kmem_huge_make(sz);
+        if (!newptr) return false;
+
+        memcpy(newptr, *pptr, osz < sz ? osz : sz);
+        free(big);
+        *pptr = newptr;
+    } else {
+        // use C library, and check return... this should behave
+        //   like this on WASM at least
+        big = realloc(big, sizeof(*big) + sz);
+        if (!big) {
+            // error
+            return false;
+        }
+        big->sz = sz;
+        *pptr = big + 1;
+    }
+#if KATA_MEM_STATS
+    kmem_stats_onfree(osz);
+    kmem_stats_onmake(sz);
+#endif
+
     return true;
 }
 
@@ -102,7 +163,7 @@ kmem_growx(void** pptr, usize* pcap, usize sz) {
     *pcap = kmem_nextcap(*pcap, sz);
 
     // only now grow to the larger capacity
-    return kmem_grow(pptr, *pcap) >= 0;
+    return kmem_grow(pptr, *pcap);
 }
 
 
@@ -120,20 +181,74 @@ kmem_nextcap(usize cap, usize sz) {
 
 KATA_API void
 kmem_free(void* ptr) {
-    free(ptr);
+    if (!ptr) return;
+    u8 kind = kmem_pmap_get(ptr);
+    if (kind == KMEM_CHUNK_SLAB) {
+#if KATA_MEM_STATS
+        kmem_stats_onfree(kmem_slab_sizeof(ptr));
+#endif
+        kmem_slab_free(ptr);
+    } else if (kind == KMEM_CHUNK_ARENA) {
+        // released along with the arena
+    } else {
+        struct kmem_big* big = ((struct kmem_big*)ptr) - 1;
+#if KATA_MEM_STATS
+        kmem_stats_onfree(big->sz);
+#endif
+        if (big->map) kmem_huge_free(ptr);
+        else free(big);
+    }
 }
 
 KATA_API usize
-kmem_hash(usize len, const u8* data) {
-    // accumulate according to djb-2
-    // SEE: http://www.cse.yorku.ca/~oz/hash.html
-    usize res = 5381 /* a magic number that works well */, i;
-    for (i = 0; i < len; i++) {
-        res = res * 33 + data[i];
+kmem_sizeof(const void* ptr) {
+    if (!ptr) return 0;
+    u8 kind = kmem_pmap_get(ptr);
+    if (kind == KMEM_CHUNK_SLAB) {
+        return kmem_slab_sizeof(ptr);
+    } else if (kind == KMEM_CHUNK_ARENA) {
+        return 0;
+    } else {
+        return (((struct kmem_big*)ptr) - 1)->sz;
     }
-    return res;
 }
 
+KATA_API kdict
+kmem_stats_dict() {
+    struct kmem_stats st;
+    kmem_stats(&st);
+
+    // per-type statistics, as 'name: (live, live_sz)'
+    kdict types = kdict_new(NULL);
+    if (!types) return NULL;
+
+    usize i;
+    for (i = 0; i < Ktypes->len; ++i) {
+        ktype tp = Ktypes->data[i];
+        usize live, live_sz;
+        kmem_stats_type(tp, &live, &live_sz);
+        ktuple v = ktuple_newz(2, (kobj[]){
+            (kobj)kint_newu(live),
+            (kobj)kint_newu(live_sz),
+        });
+        if (!v || kdict_setx(types, (kobj)tp->name, tp->name->hash, (kobj)v) < 0) {
+            KOBJ_NDECREF(v);
+            KOBJ_DECREF(types);
+            return NULL;
+        }
+        KOBJ_DECREF(v);
+    }
+
+    return kdict_newz(KDICT_IKV(
+        { "nmake", (kobj)kint_newu(st.nmake) },
+        { "nfree", (kobj)kint_newu(st.nfree) },
+        { "bmake", (kobj)kint_newu(st.bmake) },
+        { "bfree", (kobj)kint_newu(st.bfree) },
+        { "cur", (kobj)kint_newu(st.cur) },
+        { "peak", (kobj)kint_newu(st.peak) },
+        { "types", (kobj)types },
+    ));
+}
 
 KATA_API usize
 kmem_isprime(usize n) {
@@ -194,7 +309,16 @@ kmem_nextprime(usize n) {
 }
 
 
+static KCFUNC(kmem_stats_) {
+    if (!kargs(nargs, vargs, "")) return NULL;
+
+    return (kobj)kmem_stats_dict();
+}
+
 KATA_API void
 kinit_mem() {
 
+    kdict_mergez(Kglobals, KDICT_IKV(
+        { "memstats", kfunc_new(kmem_stats_, "memstats()", "Return a dict of memory statistics, including live objects per type") },
+    ));
 }
@@ -0,0 +1,360 @@
+/* src/mem/slab.c - size-class slab allocator, used by 'kmem_make' for small blocks
+ *
+ * small blocks (<= KMEM_SLAB_MAX bytes) are rounded up to one of a few size classes, and are
+ *   carved out of large aligned chunks called slabs. every slab only holds blocks of a single
+ *   size class, and freed blocks are kept on a per-class free list, so allocation and
+ *   deallocation are O(1) and never touch the C library once the slabs are warm
+ *
+ * since slabs are aligned to KMEM_SLAB_SZ, the slab of any block (and therefore its size) can
+ *   be found by masking the address. a two-level page map records which chunks of the address
+ *   space are slabs, so 'kmem_free' can tell slab blocks apart from C library blocks without
+ *   storing a header in front of every block
+ *
+ * size classes are:
+ *   * 16, 32, 48, ..., 256 (every 16 bytes)
+ *   * 320, 384, 448, 512 (every 64 bytes)
+ *   * 640, 768, 896, 1024 (every 128 bytes)
+ *
+ * ------------------------------------
+ * - THREADS
+ *
+ * every thread has its own heap, which owns a set of slabs and the free lists for them. a
+ *   thread only ever allocates from its own heap, and frees blocks of its own slabs straight
+ *   back to its own free lists, so the common case takes no locks and no atomics
+ *
+ * blocks freed by a thread that doesn't own them are collected in a small per-thread batch,
+ *   which is pushed (with a single compare-and-swap) on to the owning heap's remote list once
+ *   it is full, or the freeing thread switches owners, or 'kmem_flush' is called. the owner
+ *   takes the whole remote list (with a single exchange) once one of its free lists runs dry
+ *
+ * when a thread exits, its heap is abandoned and adopted by the next thread that needs one,
+ *   so memory isn't lost even if other threads still hold blocks from it
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/// INTERNALS ///
+
+// number of size classes
+#define NCLS 24
+
+// number of bits of a chunk number in each level of the page map
+#define PMAP_LO_BITS 16
+#define PMAP_HI_BITS 16
+
+// number of remote frees to collect before pushing them to their owner
+#define REMOTE_BATCH 64
+
+struct my_heap;
+
+// header stored at the start of every slab
+// NOTE: this is padded out, so that blocks are 16-byte aligned
+struct my_slab {
+
+    // the size class index
+    u32 cls;
+
+    // size of each block, in bytes
+    u32 sz;
+
+    // the heap that owns this slab
+    struct my_heap* owner;
+
+    // the next slab in the same size class
+    struct my_slab* next;
+
+};
+
+// size of the slab header, rounded so that blocks stay aligned
+#define SLAB_HDR (((sizeof(struct my_slab) + 63) / 64) * 64)
+
+// state for a single size class
+struct my_class {
+
+    // list of free blocks, linked through the first word of each block
+    void* free;
+
+    // bump allocation region of the newest slab, which is only used
+    //   when the free list is empty
+    u8* bump;
+    u8* bump_end;
+
+    // all slabs allocated for this class
+    struct my_slab* slabs;
+
+};
+
+// per-thread heap
+struct my_heap {
+
+    // per-class state, only touched by the owning thread
+    struct my_class cls[NCLS];
+
+    // blocks freed by other threads, linked through the first word of each block
+    _Atomic(void*) remote;
+
+    // next heap in the abandoned list
+    struct my_heap* next;
+
+};
+
+// block size of each class
+static const u32 my_cls_sz[NCLS] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 144, 160, 176, 192, 208, 224, 240, 256,
+    320, 384, 448, 512,
+    640, 768, 896, 1024,
+};
+
+// page map, indexed by the chunk number (i.e. 'addr / KMEM_SLAB_SZ'), which is split into
+//   a high part (the index into this array) and a low part (the index into the second level)
+// NOTE: second levels are allocated lazily, and entries are 'KMEM_CHUNK_*'
+static _Atomic(u8*) my_pmap[1 << PMAP_HI_BITS];
+
+// lock for allocating second levels of the page map
+static pthread_mutex_t my_pmap_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// heaps of threads which have exited, waiting to be adopted
+static struct my_heap* my_abandoned = NULL;
+static pthread_mutex_t my_abandoned_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// key used to get notified when a thread exits
+static pthread_key_t my_heap_key;
+static pthread_once_t my_heap_key_once = PTHREAD_ONCE_INIT;
+
+// the current thread's heap
+static KATA_TLS struct my_heap* my_heap = NULL;
+
+// the current thread's batch of remote frees, which all belong to 'my_pend_owner'
+static KATA_TLS struct my_heap* my_pend_owner = NULL;
+static KATA_TLS void* my_pend_head = NULL;
+static KATA_TLS void* my_pend_tail = NULL;
+static KATA_TLS usize my_pend_n = 0;
+
+
+// (internal) get the size class index for a size, which must be <= KMEM_SLAB_MAX
+static inline u32
+my_cls_of(usize sz) {
+    if (sz <= 256) return sz <= 16 ? 0 : (u32)((sz - 1) >> 4);
+    else if (sz <= 512) return 16 + (u32)((sz - 257) >> 6);
+    else return 20 + (u32)((sz - 513) >> 7);
+}
+
+// (internal) get the slab that 'ptr' is within
+static inline struct my_slab*
+my_slab_of(const void* ptr) {
+    return (struct my_slab*)((uintptr_t)ptr & ~((uintptr_t)KMEM_SLAB_SZ - 1));
+}
+
+// (internal) push the current thread's batch of remote frees on to their owner
+static void
+my_pend_flush() {
+    if (!my_pend_head) return;
+
+    void* head = atomic_load_explicit(&my_pend_owner->remote, memory_order_relaxed);
+    do {
+        *(void**)my_pend_tail = head;
+    } while (!atomic_compare_exchange_weak_explicit(&my_pend_owner->remote, &head, my_pend_head, memory_order_release, memory_order_relaxed));
+
+    my_pend_owner = NULL;
+    my_pend_head = my_pend_tail = NULL;
+    my_pend_n = 0;
+}
+
+// (internal) called when a thread exits, to give its heap up for adoption
+static void
+my_heap_abandon(void* arg) {
+    struct my_heap* h = arg;
+    my_pend_flush();
+
+    pthread_mutex_lock(&my_abandoned_lock);
+    h->next = my_abandoned;
+    my_abandoned = h;
+    pthread_mutex_unlock(&my_abandoned_lock);
+
+    my_heap = NULL;
+}
+
+// (internal) create the thread exit key
+static void
+my_heap_key_init() {
+    pthread_key_create(&my_heap_key, my_heap_abandon);
+}
+
+// (internal) get a heap for the current thread, for the first time
+static struct my_heap*
+my_heap_init() {
+    pthread_once(&my_heap_key_once, my_heap_key_init);
+
+    // try to adopt an abandoned heap, otherwise make a new one
+    pthread_mutex_lock(&my_abandoned_lock);
+    struct my_heap* h = my_abandoned;
+    if (h) my_abandoned = h->next;
+    pthread_mutex_unlock(&my_abandoned_lock);
+
+    if (!h) {
+        h = calloc(1, sizeof(*h));
+        if (!h) return NULL;
+    }
+
+    h->next = NULL;
+    pthread_setspecific(my_heap_key, h);
+    return my_heap = h;
+}
+
+// (internal) take all blocks freed remotely, and put them on the local free lists
+// NOTE: returns whether any were taken
+static bool
+my_heap_drain(struct my_heap* h) {
+    if (!atomic_load_explicit(&h->remote, memory_order_relaxed)) return false;
+
+    void* it = atomic_exchange_explicit(&h->remote, NULL, memory_order_acquire);
+    while (it) {
+        void* next = *(void**)it;
+        struct my_class* c = &h->cls[my_slab_of(it)->cls];
+        *(void**)it = c->free;
+        c->free = it;
+        it = next;
+    }
+
+    return true;
+}
+
+// (internal) allocate a new slab for a class, and make it the current bump region
+static bool
+my_slab_new(struct my_heap* h, u32 cls) {
+    void* ptr = NULL;
+    if (posix_memalign(&ptr, KMEM_SLAB_SZ, KMEM_SLAB_SZ) != 0) return false;
+
+    if (!kmem_pmap_set(ptr, KMEM_SLAB_SZ, KMEM_CHUNK_SLAB)) {
+        // out of the range of the page map
+        free(ptr);
+        return false;
+    }
+
+    struct my_slab* slab = ptr;
+    struct my_class* c = &h->cls[cls];
+    slab->cls = cls;
+    slab->sz = my_cls_sz[cls];
+    slab->owner = h;
+    slab->next = c->slabs;
+    c->slabs = slab;
+
+    c->bump = (u8*)slab + SLAB_HDR;
+    c->bump_end = (u8*)slab + KMEM_SLAB_SZ;
+    return true;
+}
+
+
+/// C API ///
+
+KATA_API u8
+kmem_pmap_get(const void* ptr) {
+    u64 cn = (u64)(uintptr_t)ptr / KMEM_SLAB_SZ;
+    if (cn >> (PMAP_HI_BITS + PMAP_LO_BITS)) return KMEM_CHUNK_NONE;
+
+    u8* lo = atomic_load_explicit(&my_pmap[cn >> PMAP_LO_BITS], memory_order_acquire);
+    return lo ? lo[cn & ((1 << PMAP_LO_BITS) - 1)] : KMEM_CHUNK_NONE;
+}
+
+KATA_API bool
+kmem_pmap_set(const void* ptr, usize sz, u8 kind) {
+    assert((uintptr_t)ptr % KMEM_SLAB_SZ == 0);
+    u64 cn = (u64)(uintptr_t)ptr / KMEM_SLAB_SZ;
+    u64 cn_end = cn + (sz + KMEM_SLAB_SZ - 1) / KMEM_SLAB_SZ;
+    if ((cn_end - 1) >> (PMAP_HI_BITS + PMAP_LO_BITS)) return false;
+
+    for (; cn < cn_end; ++cn) {
+        _Atomic(u8*)* plo = &my_pmap[cn >> PMAP_LO_BITS];
+        u8* lo = atomic_load_explicit(plo, memory_order_acquire);
+        if (!lo) {
+            pthread_mutex_lock(&my_pmap_lock);
+            lo = atomic_load_explicit(plo, memory_order_relaxed);
+            if (!lo) {
+                // NOTE: this is never freed, and costs 1 byte per chunk
+                lo = calloc(1 << PMAP_LO_BITS, 1);
+                atomic_store_explicit(plo, lo, memory_order_release);
+            }
+            pthread_mutex_unlock(&my_pmap_lock);
+            if (!lo) return false;
+        }
+        lo[cn & ((1 << PMAP_LO_BITS) - 1)] = kind;
+    }
+
+    return true;
+}
+
+KATA_API void*
+kmem_slab_make(usize sz) {
+    assert(sz <= KMEM_SLAB_MAX);
+    struct my_heap* h = my_heap;
+    if (!h && !(h = my_heap_init())) return NULL;
+
+    u32 cls = my_cls_of(sz);
+    struct my_class* c = &h->cls[cls];
+
+    // first, try and reuse a free block (possibly one freed by another thread)
+    void* res = c->free;
+    if (res || (my_heap_drain(h) && (res = c->free))) {
+        c->free = *(void**)res;
+        return res;
+    }
+
+    // otherwise, carve from the newest slab (or make a new one)
+    if (c->bump + my_cls_sz[cls] > c->bump_end) {
+        if (!my_slab_new(h, cls)) return NULL;
+    }
+
+    res = c->bump;
+    c->bump += my_cls_sz[cls];
+    return res;
+}
+
+KATA_API void
+kmem_slab_free(void* ptr) {
+    struct my_slab* slab = my_slab_of(ptr);
+    struct my_heap* owner = slab->owner;
+
+    // NOTE: a thread which only frees still needs a heap, so its batch gets
+    //   flushed when it exits
+    struct my_heap* h = my_heap;
+    if (!h) h = my_heap_init();
+
+    if (owner == h) {
+        // hot path, our own block, so push on the free list
+        struct my_class* c = &owner->cls[slab->cls];
+        *(void**)ptr = c->free;
+        c->free = ptr;
+        return;
+    }
+
+    // otherwise, add to the batch for its owner
+    if (owner != my_pend_owner) {
+        my_pend_flush();
+        my_pend_owner = owner;
+        my_pend_tail = ptr;
+    }
+    *(void**)ptr = my_pend_head;
+    my_pend_head = ptr;
+
+    if (++my_pend_n >= REMOTE_BATCH) my_pend_flush();
+}
+
+KATA_API usize
+kmem_slab_sizeof(const void* ptr) {
+    return my_slab_of(ptr)->sz;
+}
+
+KATA_API bool
+kmem_slab_has(const void* ptr) {
+    return kmem_pmap_get(ptr) == KMEM_CHUNK_SLAB;
+}
+
+KATA_API void
+kmem_flush() {
+    my_pend_flush();
+}
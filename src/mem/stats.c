@@ -0,0 +1,243 @@
+/* src/mem/stats.c - memory statistics (see 'kmem_stats')
+ *
+ * every thread keeps its own record of allocations and frees, so that counting them takes
+ *   no atomics and no shared cache lines. the number of bytes in use is only added to the
+ *   global count once a thread's change exceeds 'PEND_MAX' bytes, so the peak usage is
+ *   accurate to within 'PEND_MAX' bytes per thread
+ *
+ * live objects of each type are counted the same way, in per-thread tables indexed by
+ *   'ktype.st_idx', so hot types don't contend on shared counters
+ *
+ * records of exited threads are kept (so the totals stay correct), and adopted by the next
+ *   new thread
+ *
+ * NOTE: when 'KATA_MEM_STATS' is disabled, the hooks are never called, and 'kmem_stats'
+ *         reports all zeros
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+/// INTERNALS ///
+
+// maximum change in bytes a thread keeps before adding to the global count
+#define PEND_MAX (64 * 1024)
+
+// number of types in each chunk of per-type statistics, and the maximum number of chunks
+// NOTE: types with 'st_idx >= TCHUNK * NTCHUNK' aren't counted
+#define TCHUNK 64
+#define NTCHUNK 64
+
+// per-type statistics, for one thread
+struct my_tstat {
+
+    // change in live objects, and the bytes they use
+    // NOTE: these may be negative, since objects may be freed by another thread
+    _Atomic(s64) live, live_sz;
+
+};
+
+// per-thread record
+struct my_rec {
+
+    // number of allocations and frees
+    _Atomic(u64) nmake, nfree;
+
+    // bytes allocated and freed
+    _Atomic(u64) bmake, bfree;
+
+    // change in bytes which hasn't been added to 'my_cur'
+    _Atomic(s64) pend;
+
+    // chunks of per-type statistics, which are allocated on first use (and never freed)
+    _Atomic(struct my_tstat*) tst[NTCHUNK];
+
+    // next record in 'my_recs'
+    struct my_rec* next;
+
+    // next record in 'my_abandoned'
+    struct my_rec* next_abandoned;
+
+};
+
+// all records ever made
+static _Atomic(struct my_rec*) my_recs = NULL;
+
+// records of exited threads
+static struct my_rec* my_abandoned = NULL;
+static pthread_mutex_t my_abandoned_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// key used to get notified when a thread exits
+static pthread_key_t my_rec_key;
+static pthread_once_t my_rec_key_once = PTHREAD_ONCE_INIT;
+
+// current and peak bytes in use, not counting pending changes
+static _Atomic(s64) my_cur = 0, my_peak = 0;
+
+// the current thread's record
+static KATA_TLS struct my_rec* my_rec = NULL;
+
+// add to a counter only written by the owning thread, without a locked instruction
+#define ADD(var_, val_) atomic_store_explicit(&(var_), atomic_load_explicit(&(var_), memory_order_relaxed) + (val_), memory_order_relaxed)
+
+// read a counter
+#define GET(var_) atomic_load_explicit(&(var_), memory_order_relaxed)
+
+
+// (internal) add a change to the global count, and update the peak
+static void
+my_add_cur(s64 delta) {
+    s64 cur = atomic_fetch_add_explicit(&my_cur, delta, memory_order_relaxed) + delta;
+    s64 peak = atomic_load_explicit(&my_peak, memory_order_relaxed);
+    while (cur > peak && !atomic_compare_exchange_weak_explicit(&my_peak, &peak, cur, memory_order_relaxed, memory_order_relaxed)) {
+    }
+}
+
+// (internal) called when a thread exits, to give its record up for adoption
+static void
+my_rec_abandon(void* arg) {
+    struct my_rec* r = arg;
+
+    // flush pending changes
+    my_add_cur(GET(r->pend));
+    atomic_store_explicit(&r->pend, 0, memory_order_relaxed);
+
+    pthread_mutex_lock(&my_abandoned_lock);
+    r->next_abandoned = my_abandoned;
+    my_abandoned = r;
+    pthread_mutex_unlock(&my_abandoned_lock);
+
+    my_rec = NULL;
+}
+
+// (internal) create the thread exit key
+static void
+my_rec_key_init() {
+    pthread_key_create(&my_rec_key, my_rec_abandon);
+}
+
+// (internal) get a record for the current thread, for the first time
+static struct my_rec*
+my_rec_init() {
+    pthread_once(&my_rec_key_once, my_rec_key_init);
+
+    // try to adopt an abandoned record, otherwise make a new one
+    pthread_mutex_lock(&my_abandoned_lock);
+    struct my_rec* r = my_abandoned;
+    if (r) my_abandoned = r->next_abandoned;
+    pthread_mutex_unlock(&my_abandoned_lock);
+
+    if (!r) {
+        // NOTE: these are never freed
+        r = calloc(1, sizeof(*r));
+        if (!r) return NULL;
+
+        r->next = atomic_load_explicit(&my_recs, memory_order_relaxed);
+        while (!atomic_compare_exchange_weak_explicit(&my_recs, &r->next, r, memory_order_release, memory_order_relaxed)) {
+        }
+    }
+
+    pthread_setspecific(my_rec_key, r);
+    return my_rec = r;
+}
+
+
+/// C API ///
+
+KATA_API void
+kmem_stats_onmake(usize sz) {
+    struct my_rec* r = my_rec;
+    if (!r && !(r = my_rec_init())) return;
+
+    ADD(r->nmake, 1);
+    ADD(r->bmake, sz);
+
+    s64 pend = GET(r->pend) + (s64)sz;
+    if (pend >= PEND_MAX) {
+        my_add_cur(pend);
+        pend = 0;
+    }
+    atomic_store_explicit(&r->pend, pend, memory_order_relaxed);
+}
+
+KATA_API void
+kmem_stats_onfree(usize sz) {
+    struct my_rec* r = my_rec;
+    if (!r && !(r = my_rec_init())) return;
+
+    ADD(r->nfree, 1);
+    ADD(r->bfree, sz);
+
+    s64 pend = GET(r->pend) - (s64)sz;
+    if (pend <= -PEND_MAX) {
+        my_add_cur(pend);
+        pend = 0;
+    }
+    atomic_store_explicit(&r->pend, pend, memory_order_relaxed);
+}
+
+KATA_API void
+kmem_stats_onobj(ktype tp, s64 n, s64 sz) {
+    struct my_rec* r = my_rec;
+    if (!r && !(r = my_rec_init())) return;
+
+    s32 idx = tp->st_idx;
+    if (idx < 0 || idx >= TCHUNK * NTCHUNK) return;
+
+    struct my_tstat* c = atomic_load_explicit(&r->tst[idx / TCHUNK], memory_order_relaxed);
+    if (!c) {
+        // NOTE: this isn't 'kmem_make', since that calls these hooks
+        c = calloc(TCHUNK, sizeof(*c));
+        if (!c) return;
+        atomic_store_explicit(&r->tst[idx / TCHUNK], c, memory_order_release);
+    }
+
+    ADD(c[idx % TCHUNK].live, n);
+    ADD(c[idx % TCHUNK].live_sz, sz);
+}
+
+KATA_API void
+kmem_stats_type(ktype tp, usize* live, usize* live_sz) {
+    s64 n = 0, sz = 0;
+    s32 idx = tp->st_idx;
+    if (idx >= 0 && idx < TCHUNK * NTCHUNK) {
+        struct my_rec* r = atomic_load_explicit(&my_recs, memory_order_acquire);
+        while (r) {
+            struct my_tstat* c = atomic_load_explicit(&r->tst[idx / TCHUNK], memory_order_acquire);
+            if (c) {
+                n += GET(c[idx % TCHUNK].live);
+                sz += GET(c[idx % TCHUNK].live_sz);
+            }
+            r = r->next;
+        }
+    }
+
+    // NOTE: counts are read while other threads change them, so they may be briefly off
+    *live = n > 0 ? n : 0;
+    *live_sz = sz > 0 ? sz : 0;
+}
+
+KATA_API void
+kmem_stats(struct kmem_stats* out) {
+    memset(out, 0, sizeof(*out));
+
+    s64 pend = 0;
+    struct my_rec* r = atomic_load_explicit(&my_recs, memory_order_acquire);
+    while (r) {
+        out->nmake += GET(r->nmake);
+        out->nfree += GET(r->nfree);
+        out->bmake += GET(r->bmake);
+        out->bfree += GET(r->bfree);
+        pend += GET(r->pend);
+        r = r->next;
+    }
+
+    s64 cur = atomic_load_explicit(&my_cur, memory_order_relaxed) + pend;
+    s64 peak = atomic_load_explicit(&my_peak, memory_order_relaxed);
+    out->cur = cur > 0 ? cur : 0;
+    out->peak = peak > cur ? peak : cur;
+}
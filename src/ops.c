@@ -1,187 +1,270 @@
 /* src/ops.c - 'kop_*' operator implementations
+ *
+ * binary operators dispatch through a table indexed by the operator and the ids of both
+ *   operand types (see 'ktype.id'), which holds a kernel specialized for that pair. pairs
+ *   without a kernel fall back to the left operand's C slot (i.e. 'c_add'), and then to
+ *   its attributes (i.e. '__add')
  *
  * @author: Cade Brown <me@cade.site>
  */
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
 
-KATA_API kobj
-kop_add(kobj a, kobj b) {
-    ktype tpa = KOBJ_TYPE(a), tpb = KOBJ_TYPE(b);
+// dispatch table of kernels, indexed by '[op][a->id][b->id]'
+// NOTE: id 0 is never registered, so types without an id always fall back
+static kslot_binop my_table[KOP_N][KTYPE_MAXID][KTYPE_MAXID];
 
-    if (tpa == Kstr) return kstr_fmt("%S%S", a, b);
+// offsets of the C slot in 'struct ktype' for each operator
+static const usize my_slots[KOP_N] = {
+    offsetof(struct ktype, c_add),
+    offsetof(struct ktype, c_mul),
+    offsetof(struct ktype, c_div),
+    offsetof(struct ktype, c_fdiv),
+    offsetof(struct ktype, c_pow),
+};
 
-    if (tpa->is_float && tpb->is_float) {
-        bool doa, dob;
-        bf_t bfa, bfb;
-        if (!kbf_const(a, &bfa, &doa)) return NULL;
-        if (!kbf_const(b, &bfb, &dob)) {
-            if (doa) kbf_done(&bfa);
-            return NULL;
-        }
+// attribute names for each operator, made in 'kinit_ops'
+static const char* my_attrs[KOP_N] = { "__add", "__mul", "__div", "__fdiv", "__pow" };
+static kstr my_names[KOP_N];
 
-        bf_t bfc;
-        if (!kbf_init(&bfc, NULL)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            return NULL;
-        }
+// operator symbols, for error messages
+static const char* my_syms[KOP_N] = { "+", "*", "/", "//", "^" };
 
-        if (bf_add(&bfc, &bfa, &bfb, kbf_precy(&bfa, &bfb), BF_RNDF) & ~(BF_ST_INEXACT)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            kbf_done(&bfc);
-            return NULL;
-        }
+// libbf binary operation signature (i.e. 'bf_add')
+typedef int (*my_bfop)(bf_t* r, const bf_t* a, const bf_t* b, limb_t prec, bf_flags_t flags);
 
+// (internal) throw an error for operands which don't support an operator
+static kobj
+my_unsupported(s32 op, kobj a, kobj b) {
+    KTHROW(Kexc, "unsupported operand types for '%s': '%S' and '%S'", my_syms[op], KOBJ_TYPE(a)->name, KOBJ_TYPE(b)->name);
+    return NULL;
+}
+
+// (internal) apply a libbf operation to two numbers, and store the result in 'res', which
+//   should be freed with 'kbf_done()'
+static bool
+my_bf(s32 op, kobj a, kobj b, my_bfop fn, bf_flags_t flags, bf_t* res) {
+    if (!KOBJ_TYPE(a)->is_float || !KOBJ_TYPE(b)->is_float) {
+        my_unsupported(op, a, b);
+        return false;
+    }
+
+    bool doa, dob;
+    bf_t bfa, bfb;
+    if (!kbf_const(a, &bfa, &doa)) return false;
+    if (!kbf_const(b, &bfb, &dob)) {
+        if (doa) kbf_done(&bfa);
+        return false;
+    }
+
+    if (!kbf_init(res, NULL)) {
         if (doa) kbf_done(&bfa);
         if (dob) kbf_done(&bfb);
-        return (kobj)kint_newz(&bfc);
+        return false;
     }
 
-    assert(false);
+    bool ok = !(fn(res, &bfa, &bfb, kbf_precy(&bfa, &bfb), flags) & ~(BF_ST_INEXACT));
+    if (doa) kbf_done(&bfa);
+    if (dob) kbf_done(&bfb);
+    if (!ok) kbf_done(res);
+    return ok;
 }
 
-KATA_API kobj
-kop_mul(kobj a, kobj b) {
-    ktype tpa = KOBJ_TYPE(a), tpb = KOBJ_TYPE(b);
-
-    if (tpa->is_float && tpb->is_float) {
-        bool doa, dob;
-        bf_t bfa, bfb;
-        if (!kbf_const(a, &bfa, &doa)) return NULL;
-        if (!kbf_const(b, &bfb, &dob)) {
-            if (doa) kbf_done(&bfa);
-            return NULL;
-        }
+// (internal) make the result of an operation that keeps integers as integers
+static kobj
+my_num(kobj a, kobj b, bf_t* res) {
+    if (KOBJ_TYPE(a)->is_int && KOBJ_TYPE(b)->is_int) return (kobj)kint_newz(res);
+    return (kobj)kfloat_newz(res);
+}
 
-        bf_t bfc;
-        if (!kbf_init(&bfc, NULL)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            return NULL;
-        }
+// (internal) fallback for pairs without a kernel
+static kobj
+my_fallback(s32 op, kobj a, kobj b) {
+    ktype tp = KOBJ_TYPE(a);
 
-        if (bf_mul(&bfc, &bfa, &bfb, kbf_precy(&bfa, &bfb), BF_RNDD) & ~(BF_ST_INEXACT)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            kbf_done(&bfc);
-            return NULL;
-        }
+    // C slot of the left operand
+    kslot_binop fn = *(kslot_binop*)((u8*)tp + my_slots[op]);
+    if (fn) return fn(a, b);
 
-        if (doa) kbf_done(&bfa);
-        if (dob) kbf_done(&bfb);
-        return (tpa->is_int && tpb->is_int) ? (kobj)kint_newz(&bfc) : kfloat_newz(&bfc);
+    // attribute of the left operand
+    kobj attr;
+    if (tp->attr && my_names[op] && kdict_get(tp->attr, (kobj)my_names[op], &attr)) {
+        return kcall(attr, 2, (kobj[]){ a, b });
     }
 
-    assert(false);
+    return my_unsupported(op, a, b);
 }
 
-KATA_API kobj
-kop_div(kobj a, kobj b) {
-    ktype tpa = KOBJ_TYPE(a), tpb = KOBJ_TYPE(b);
-
-    if (tpa->is_float && tpb->is_float) {
-        bool doa, dob;
-        bf_t bfa, bfb;
-        if (!kbf_const(a, &bfa, &doa)) return NULL;
-        if (!kbf_const(b, &bfb, &dob)) {
-            if (doa) kbf_done(&bfa);
-            return NULL;
-        }
+// (internal) dispatch a binary operator
+static inline kobj
+my_binop(s32 op, kobj a, kobj b) {
+    kslot_binop fn = my_table[op][KOBJ_TYPE(a)->id][KOBJ_TYPE(b)->id];
+    if (fn) return fn(a, b);
+    return my_fallback(op, a, b);
+}
 
-        bf_t bfc;
-        if (!kbf_init(&bfc, NULL)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            return NULL;
+// (internal) int + int
+static kobj
+my_add_ii(kobj a, kobj b) {
+    if (KINT_ISSMALL(a) && KINT_ISSMALL(b)) {
+        // fast path, native math unless it overflows
+        s64 r;
+        if (!__builtin_add_overflow(KINT_SMALL(a), KINT_SMALL(b), &r)) {
+            return (kobj)kint_news(r);
         }
+    }
 
-        if (bf_div(&bfc, &bfa, &bfb, kbf_precy(&bfa, &bfb), BF_RNDF) & ~(BF_ST_INEXACT)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            kbf_done(&bfc);
-            return NULL;
-        }
+    return kop_add_bf(a, b);
+}
 
-        if (doa) kbf_done(&bfa);
-        if (dob) kbf_done(&bfb);
-        return kfloat_newz(&bfc);
+// (internal) int * int
+static kobj
+my_mul_ii(kobj a, kobj b) {
+    if (KINT_ISSMALL(a) && KINT_ISSMALL(b)) {
+        // fast path, native math unless it overflows
+        s64 r;
+        if (!__builtin_mul_overflow(KINT_SMALL(a), KINT_SMALL(b), &r)) {
+            return (kobj)kint_news(r);
+        }
     }
 
-    assert(false);
+    return kop_mul_bf(a, b);
 }
 
-KATA_API kobj
-kop_fdiv(kobj a, kobj b) {
-    ktype tpa = KOBJ_TYPE(a), tpb = KOBJ_TYPE(b);
-
-    if (tpa->is_float && tpb->is_float) {
-        bool doa, dob;
-        bf_t bfa, bfb;
-        if (!kbf_const(a, &bfa, &doa)) return NULL;
-        if (!kbf_const(b, &bfb, &dob)) {
-            if (doa) kbf_done(&bfa);
-            return NULL;
+// (internal) int // int
+static kobj
+my_fdiv_ii(kobj a, kobj b) {
+    if (KINT_ISSMALL(a) && KINT_ISSMALL(b)) {
+        // fast path, native math (rounding towards negative infinity) unless it overflows,
+        //   or is a division by zero
+        s64 x = KINT_SMALL(a), y = KINT_SMALL(b);
+        if (y != 0 && !(x == INT64_MIN && y == -1)) {
+            s64 r = x / y;
+            if (x % y != 0 && ((x < 0) != (y < 0))) r--;
+            return (kobj)kint_news(r);
         }
+    }
 
-        bf_t bfc;
-        if (!kbf_init(&bfc, NULL)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            return NULL;
-        }
+    return kop_fdiv_bf(a, b);
+}
 
-        if ((bf_div(&bfc, &bfa, &bfb, kbf_precy(&bfa, &bfb), BF_RNDF) & ~(BF_ST_INEXACT)) || (bf_rint(&bfc, BF_RNDF) & ~(BF_ST_INEXACT))) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            kbf_done(&bfc);
-            return NULL;
-        }
+// (internal) str + str, which is lazy for long strings (see 'kstr_concat')
+static kobj
+my_add_ss(kobj a, kobj b) {
+    return (kobj)kstr_concat((kstr)a, (kstr)b);
+}
 
-        if (doa) kbf_done(&bfa);
-        if (dob) kbf_done(&bfb);
-        return (kobj)kint_newz(&bfc);
+
+/// C API ///
+
+KATA_API bool
+kop_register(s32 op, ktype a, ktype b, kslot_binop fn) {
+    if (op < 0 || op >= KOP_N || a->id <= 0 || b->id <= 0) return false;
+    my_table[op][a->id][b->id] = fn;
+    return true;
+}
+
+KATA_API kobj
+kop_add(kobj a, kobj b) {
+    return my_binop(KOP_ADD, a, b);
+}
+
+KATA_API kobj
+kop_addz(kobj a, kobj b) {
+    // strings may be appended to in place
+    if (KOBJ_TYPE(a) == Kstr && KOBJ_TYPE(b) == Kstr) {
+        return (kobj)kstr_concatz((kstr)a, (kstr)b);
     }
 
-    assert(false);
+    kobj res = kop_add(a, b);
+    KOBJ_DECREF(a);
+    return res;
+}
+
+KATA_API kobj
+kop_mul(kobj a, kobj b) {
+    return my_binop(KOP_MUL, a, b);
 }
 
+KATA_API kobj
+kop_div(kobj a, kobj b) {
+    return my_binop(KOP_DIV, a, b);
+}
 
+KATA_API kobj
+kop_fdiv(kobj a, kobj b) {
+    return my_binop(KOP_FDIV, a, b);
+}
 
 KATA_API kobj
 kop_pow(kobj a, kobj b) {
-    ktype tpa = KOBJ_TYPE(a), tpb = KOBJ_TYPE(b);
-
-    if (tpa->is_float && tpb->is_float) {
-        bool doa, dob;
-        bf_t bfa, bfb;
-        if (!kbf_const(a, &bfa, &doa)) return NULL;
-        if (!kbf_const(b, &bfb, &dob)) {
-            if (doa) kbf_done(&bfa);
-            return NULL;
-        }
+    return my_binop(KOP_POW, a, b);
+}
 
-        bf_t bfc;
-        if (!kbf_init(&bfc, NULL)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            return NULL;
-        }
-        
-        if (bf_pow(&bfc, &bfa, &bfb, kbf_precy(&bfa, &bfb), BF_RNDF) & ~(BF_ST_INEXACT)) {
-            if (doa) kbf_done(&bfa);
-            if (dob) kbf_done(&bfb);
-            kbf_done(&bfc);
-            return NULL;
-        }
+KATA_API kobj
+kop_add_bf(kobj a, kobj b) {
+    bf_t r;
+    if (!my_bf(KOP_ADD, a, b, bf_add, BF_RNDF, &r)) return NULL;
+    return my_num(a, b, &r);
+}
 
-        if (doa) kbf_done(&bfa);
-        if (dob) kbf_done(&bfb);
-        return kfloat_newz(&bfc);
+KATA_API kobj
+kop_mul_bf(kobj a, kobj b) {
+    bf_t r;
+    if (!my_bf(KOP_MUL, a, b, bf_mul, BF_RNDD, &r)) return NULL;
+    return my_num(a, b, &r);
+}
+
+KATA_API kobj
+kop_div_bf(kobj a, kobj b) {
+    bf_t r;
+    if (!my_bf(KOP_DIV, a, b, bf_div, BF_RNDF, &r)) return NULL;
+    return (kobj)kfloat_newz(&r);
+}
+
+KATA_API kobj
+kop_fdiv_bf(kobj a, kobj b) {
+    bf_t r;
+    if (!my_bf(KOP_FDIV, a, b, bf_div, BF_RNDF, &r)) return NULL;
+    if (bf_rint(&r, BF_RNDF) & ~(BF_ST_INEXACT)) {
+        kbf_done(&r);
+        return NULL;
     }
+    return (kobj)kint_newz(&r);
+}
 
-    assert(false);
+KATA_API kobj
+kop_pow_bf(kobj a, kobj b) {
+    bf_t r;
+    if (!my_bf(KOP_POW, a, b, bf_pow, BF_RNDF, &r)) return NULL;
+    return (kobj)kfloat_newz(&r);
 }
 
+KATA_API void
+kinit_ops() {
+    s32 op;
+    for (op = 0; op < KOP_N; ++op) {
+        my_names[op] = kstr_intern(-1, my_attrs[op]);
+        assert(my_names[op] != NULL);
+    }
+
+    // int/int, which try native math first
+    kop_register(KOP_ADD, Kint, Kint, my_add_ii);
+    kop_register(KOP_MUL, Kint, Kint, my_mul_ii);
+    kop_register(KOP_DIV, Kint, Kint, kop_div_bf);
+    kop_register(KOP_FDIV, Kint, Kint, my_fdiv_ii);
+    kop_register(KOP_POW, Kint, Kint, kop_pow_bf);
+
+    // mixed int/float and float/float, which always use libbf
+    static const kslot_binop bfs[KOP_N] = { kop_add_bf, kop_mul_bf, kop_div_bf, kop_fdiv_bf, kop_pow_bf };
+    for (op = 0; op < KOP_N; ++op) {
+        kop_register(op, Kint, Kfloat, bfs[op]);
+        kop_register(op, Kfloat, Kint, bfs[op]);
+        kop_register(op, Kfloat, Kfloat, bfs[op]);
+    }
+
+    // str/str
+    kop_register(KOP_ADD, Kstr, Kstr, my_add_ss);
+}
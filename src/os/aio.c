@@ -0,0 +1,534 @@
+/* src/os/aio.c - kos_aio type implementation, for async IO
+ *
+ * requests are queued by 'kos_aio_submit', and sent to the backend in batches by
+ *   'kos_aio_poll' and 'kos_aio_wait', which also handle completions (calling callbacks on
+ *   the calling thread)
+ *
+ * the io_uring backend uses the system calls directly (instead of liburing), and shares the
+ *   submission and completion rings with the kernel, so a whole batch is submitted (and
+ *   completions are waited for) with a single 'io_uring_enter'. the fallback is a small pool
+ *   of worker threads doing blocking IO
+ *
+ * SEE: https://kernel.dk/io_uring.pdf
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+
+#if defined(__linux__) && defined(__has_include)
+  #if __has_include(<linux/io_uring.h>)
+    #include <linux/io_uring.h>
+    #include <sys/syscall.h>
+    #include <sys/mman.h>
+    #if defined(__NR_io_uring_setup) && defined(IO_URING_OP_SUPPORTED)
+      #define MY_URING 1
+    #endif
+  #endif
+#endif
+
+#ifndef MY_URING
+  #define MY_URING 0
+#endif
+
+/// INTERNALS ///
+
+// (internal) queue of requests, in order
+struct my_queue {
+    struct kos_aio_req *head, *tail;
+};
+
+// (internal) add a request to the end of a queue
+static void
+my_qpush(struct my_queue* q, struct kos_aio_req* req) {
+    req->next_ = NULL;
+    if (q->tail) q->tail->next_ = req;
+    else q->head = req;
+    q->tail = req;
+}
+
+// (internal) remove the first request from a queue, or return NULL if it is empty
+static struct kos_aio_req*
+my_qpop(struct my_queue* q) {
+    struct kos_aio_req* req = q->head;
+    if (req) {
+        q->head = req->next_;
+        if (!q->head) q->tail = NULL;
+    }
+    return req;
+}
+
+#if MY_URING
+
+// (internal) io_uring backend
+struct my_uring {
+
+    // file descriptor of the ring
+    s32 fd;
+
+    // submission ring, which we produce and the kernel consumes
+    u32 *sq_head, *sq_tail, *sq_mask, *sq_array;
+    struct io_uring_sqe* sqes;
+
+    // completion ring, which the kernel produces and we consume
+    u32 *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe* cqes;
+    u32 cq_entries;
+
+    // number of requests sent to the kernel, but not completed
+    u32 nsent;
+
+    // mappings, and their sizes
+    void *sq_ptr, *cq_ptr;
+    usize sq_sz, cq_sz, sqes_sz;
+
+};
+
+#endif
+
+// (internal) thread pool backend
+struct my_pool {
+
+    // lock for everything, and conditions for work being available and work being done
+    pthread_mutex_t lock;
+    pthread_cond_t work, done;
+
+    // requests waiting for a worker, and requests which are done
+    struct my_queue todo, fin;
+
+    // whether the workers should stop
+    bool stop;
+
+    // the workers
+    pthread_t threads[KOS_AIO_NTHREADS];
+    s32 nthreads;
+
+};
+
+// (internal) state of an async IO engine
+struct my_state {
+
+    // requests submitted, but not sent to the backend yet
+    struct my_queue queue;
+
+#if MY_URING
+    struct my_uring ring;
+#endif
+    struct my_pool pool;
+
+};
+
+// (internal) get the memory a request transfers to or from
+#define PTR(req_) ((req_)->buf->data + (req_)->buf->pos)
+
+// (internal) handle a request being done
+static void
+my_complete(kos_aio obj, struct kos_aio_req* req, ssize res) {
+    kbuffer buf = req->buf;
+    if (res > 0) {
+        buf->pos += res;
+        if (buf->len < buf->pos) buf->len = buf->pos;
+    }
+
+    obj->nflight--;
+    buf->aio = false;
+    req->res = res;
+    req->done = true;
+
+    // NOTE: the request may be reused (or freed) by the callback, so it isn't used after
+    void (*cb)(struct kos_aio_req* req) = req->cb;
+    if (cb) cb(req);
+    KOBJ_DECREF(buf);
+}
+
+#if MY_URING
+
+// (internal) set up an io_uring, returning whether it is supported
+static bool
+my_uring_init(struct my_uring* r, u32 depth) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = syscall(__NR_io_uring_setup, depth, &p);
+    if (r->fd < 0) return false;
+
+    // 'IORING_OP_READ' and 'IORING_OP_WRITE' are needed, which older kernels don't have
+    usize psz = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = kmem_make(psz);
+    bool ok = probe != NULL;
+    if (ok) {
+        memset(probe, 0, psz);
+        ok = syscall(__NR_io_uring_register, r->fd, IORING_REGISTER_PROBE, probe, 256) >= 0
+            && probe->last_op >= IORING_OP_WRITE
+            && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED)
+            && (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED);
+        kmem_free(probe);
+    }
+    if (!ok) {
+        close(r->fd);
+        return false;
+    }
+
+    // map the rings, which may be a single mapping
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    r->sq_sz = p.sq_off.array + p.sq_entries * sizeof(u32);
+    r->cq_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (single) {
+        if (r->cq_sz > r->sq_sz) r->sq_sz = r->cq_sz;
+        r->cq_sz = r->sq_sz;
+    }
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    r->sq_ptr = mmap(NULL, r->sq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ptr == MAP_FAILED) {
+        close(r->fd);
+        return false;
+    }
+    r->cq_ptr = single ? r->sq_ptr : mmap(NULL, r->cq_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    if (r->cq_ptr == MAP_FAILED) {
+        munmap(r->sq_ptr, r->sq_sz);
+        close(r->fd);
+        return false;
+    }
+    r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        if (!single) munmap(r->cq_ptr, r->cq_sz);
+        munmap(r->sq_ptr, r->sq_sz);
+        close(r->fd);
+        return false;
+    }
+
+    u8* sq = r->sq_ptr;
+    r->sq_head = (u32*)(sq + p.sq_off.head);
+    r->sq_tail = (u32*)(sq + p.sq_off.tail);
+    r->sq_mask = (u32*)(sq + p.sq_off.ring_mask);
+    r->sq_array = (u32*)(sq + p.sq_off.array);
+
+    u8* cq = r->cq_ptr;
+    r->cq_head = (u32*)(cq + p.cq_off.head);
+    r->cq_tail = (u32*)(cq + p.cq_off.tail);
+    r->cq_mask = (u32*)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe*)(cq + p.cq_off.cqes);
+    r->cq_entries = p.cq_entries;
+
+    r->nsent = 0;
+    return true;
+}
+
+// (internal) tear down an io_uring
+static void
+my_uring_done(struct my_uring* r) {
+    munmap(r->sqes, r->sqes_sz);
+    if (r->cq_ptr != r->sq_ptr) munmap(r->cq_ptr, r->cq_sz);
+    munmap(r->sq_ptr, r->sq_sz);
+    close(r->fd);
+}
+
+// (internal) move queued requests into the submission ring, and enter the kernel to submit
+//   them (waiting for at least 'wait' completions)
+static keno
+my_uring_send(struct my_state* st, u32 wait) {
+    struct my_uring* r = &st->ring;
+    u32 mask = *r->sq_mask, tail = *r->sq_tail;
+
+    // NOTE: requests in flight are limited by the size of the completion ring, so it can't
+    //         overflow
+    while (st->queue.head && tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) <= mask && r->nsent < r->cq_entries) {
+        struct kos_aio_req* req = my_qpop(&st->queue);
+        u32 idx = tail & mask;
+        struct io_uring_sqe* sqe = &r->sqes[idx];
+        memset(sqe, 0, sizeof(*sqe));
+        sqe->opcode = req->kind == KOS_AIO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+        sqe->fd = req->fd;
+        sqe->addr = (u64)(uintptr_t)PTR(req);
+        sqe->len = req->len;
+        sqe->off = (u64)req->off;
+        sqe->user_data = (u64)(uintptr_t)req;
+        r->sq_array[idx] = idx;
+        tail++;
+        r->nsent++;
+    }
+    __atomic_store_n(r->sq_tail, tail, __ATOMIC_RELEASE);
+
+    u32 nsub = tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    if (nsub == 0 && wait == 0) return 0;
+
+    while (true) {
+        s32 rc = syscall(__NR_io_uring_enter, r->fd, nsub, wait, wait > 0 ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+        if (rc >= 0) return 0;
+        if (errno == EINTR) continue;
+        // NOTE: completions must be reaped to make room, which happens after this
+        if (errno == EAGAIN || errno == EBUSY) return 0;
+        return -1;
+    }
+}
+
+// (internal) handle completions from an io_uring, returning how many there were
+static s32
+my_uring_reap(kos_aio obj, struct my_state* st) {
+    struct my_uring* r = &st->ring;
+    u32 head = *r->cq_head, tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE), mask = *r->cq_mask;
+    s32 res = 0;
+    while (head != tail) {
+        struct io_uring_cqe* cqe = &r->cqes[head & mask];
+        struct kos_aio_req* req = (struct kos_aio_req*)(uintptr_t)cqe->user_data;
+        ssize rv = cqe->res;
+
+        // release the entry before the callback, which may submit more
+        head++;
+        __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+        r->nsent--;
+
+        my_complete(obj, req, rv);
+        res++;
+    }
+    return res;
+}
+
+#endif
+
+// (internal) worker thread for the thread pool backend
+static void*
+my_worker(void* arg) {
+    struct my_pool* pool = arg;
+    pthread_mutex_lock(&pool->lock);
+    while (true) {
+        struct kos_aio_req* req;
+        while (!(req = my_qpop(&pool->todo)) && !pool->stop) {
+            pthread_cond_wait(&pool->work, &pool->lock);
+        }
+        if (!req) break;
+        pthread_mutex_unlock(&pool->lock);
+
+        // do the blocking IO
+        ssize rv;
+        do {
+            if (req->kind == KOS_AIO_READ) {
+                rv = req->off >= 0 ? pread(req->fd, PTR(req), req->len, req->off) : read(req->fd, PTR(req), req->len);
+            } else {
+                rv = req->off >= 0 ? pwrite(req->fd, PTR(req), req->len, req->off) : write(req->fd, PTR(req), req->len);
+            }
+        } while (rv < 0 && errno == EINTR);
+        req->res = rv < 0 ? -errno : rv;
+
+        pthread_mutex_lock(&pool->lock);
+        my_qpush(&pool->fin, req);
+        pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+// (internal) start the thread pool backend
+static bool
+my_pool_init(struct my_pool* pool) {
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    pool->todo.head = pool->todo.tail = NULL;
+    pool->fin.head = pool->fin.tail = NULL;
+    pool->stop = false;
+
+    for (pool->nthreads = 0; pool->nthreads < KOS_AIO_NTHREADS; pool->nthreads++) {
+        if (pthread_create(&pool->threads[pool->nthreads], NULL, my_worker, pool) != 0) break;
+    }
+    return pool->nthreads > 0;
+}
+
+// (internal) stop the thread pool backend
+static void
+my_pool_done(struct my_pool* pool) {
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    s32 i;
+    for (i = 0; i < pool->nthreads; ++i) pthread_join(pool->threads[i], NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// (internal) hand queued requests to the workers
+static void
+my_pool_send(struct my_state* st) {
+    if (!st->queue.head) return;
+    struct my_pool* pool = &st->pool;
+    pthread_mutex_lock(&pool->lock);
+    struct kos_aio_req* req;
+    while ((req = my_qpop(&st->queue))) my_qpush(&pool->todo, req);
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// (internal) handle completions from the workers, waiting for at least one if 'block',
+//   returning how many there were
+static s32
+my_pool_reap(kos_aio obj, struct my_state* st, bool block) {
+    struct my_pool* pool = &st->pool;
+    pthread_mutex_lock(&pool->lock);
+    while (block && !pool->fin.head) pthread_cond_wait(&pool->done, &pool->lock);
+    struct my_queue fin = pool->fin;
+    pool->fin.head = pool->fin.tail = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    s32 res = 0;
+    struct kos_aio_req* req;
+    while ((req = my_qpop(&fin))) {
+        my_complete(obj, req, req->res);
+        res++;
+    }
+    return res;
+}
+
+// (internal) send requests, and handle completions (waiting for at least one if 'block')
+static s32
+my_step(kos_aio obj, bool block) {
+    struct my_state* st = obj->state_;
+#if MY_URING
+    if (obj->mode == KOS_AIO_URING) {
+        s32 res = my_uring_reap(obj, st);
+        if (my_uring_send(st, block && res == 0 ? 1 : 0) < 0) return -1;
+        return res + my_uring_reap(obj, st);
+    }
+#endif
+    my_pool_send(st);
+    return my_pool_reap(obj, st, block);
+}
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kos_aio v = (kos_aio)obj;
+    struct my_state* st = v->state_;
+
+    // NOTE: requests refer to memory the kernel (or workers) are still using, so they have
+    //         to finish first
+    while (v->nflight > 0) {
+        if (kos_aio_wait(v, v->nflight) < 0) break;
+    }
+
+#if MY_URING
+    if (v->mode == KOS_AIO_URING) my_uring_done(&st->ring);
+#endif
+    if (v->mode == KOS_AIO_THREADS) my_pool_done(&st->pool);
+
+    kmem_free(st);
+    kobj_del(obj);
+}
+
+
+/// C API ///
+
+KTYPE_DECL(Kos_aio);
+
+KATA_API kos_aio
+kos_aio_new(u32 depth, s32 mode) {
+    struct my_state* st = kmem_make(sizeof(*st));
+    if (!st) return NULL;
+    st->queue.head = st->queue.tail = NULL;
+    if (depth < 1) depth = 1;
+
+    s32 rmode = -1;
+#if MY_URING
+    if ((mode == KOS_AIO_AUTO || mode == KOS_AIO_URING) && my_uring_init(&st->ring, depth)) {
+        rmode = KOS_AIO_URING;
+    }
+#endif
+    if (rmode < 0 && (mode == KOS_AIO_AUTO || mode == KOS_AIO_THREADS) && my_pool_init(&st->pool)) {
+        rmode = KOS_AIO_THREADS;
+    }
+    if (rmode < 0) {
+        kmem_free(st);
+        KTHROW(Kexc, "async IO backend is not available");
+        return NULL;
+    }
+
+    kos_aio obj = kobj_make(Kos_aio);
+    if (!obj) {
+#if MY_URING
+        if (rmode == KOS_AIO_URING) my_uring_done(&st->ring);
+#endif
+        if (rmode == KOS_AIO_THREADS) my_pool_done(&st->pool);
+        kmem_free(st);
+        return NULL;
+    }
+
+    obj->mode = rmode;
+    obj->nflight = 0;
+    obj->state_ = st;
+    return obj;
+}
+
+KATA_API keno
+kos_aio_submit(kos_aio obj, struct kos_aio_req* req) {
+    struct my_state* st = obj->state_;
+    kbuffer buf = req->buf;
+    if (buf->aio) {
+        // NOTE: both requests would transfer at the same position
+        KTHROW(Kexc, "buffer is already used by another async IO request");
+        return KENO_ERR;
+    } else if (buf->ring) {
+        // NOTE: a transfer may wrap around a ring, and the backends only take a single span
+        KTHROW(Kexc, "async IO doesn't support ring buffers");
+        return KENO_ERR;
+    } else if (req->kind == KOS_AIO_READ) {
+        // make room to read into, since the buffer can't be reallocated while in flight
+        if (buf->cap < buf->pos + req->len && !kmem_growx((void**)&buf->data, &buf->cap, buf->pos + req->len)) {
+            return KENO_ERR_OOM;
+        }
+    } else if (req->kind == KOS_AIO_WRITE) {
+        if (buf->pos + req->len > buf->len) {
+            KTHROW(Kexc, "write is past the end of the buffer");
+            return KENO_ERR;
+        }
+    } else {
+        KTHROW(Kexc, "invalid async IO request kind: %i", (int)req->kind);
+        return KENO_ERR;
+    }
+
+    KOBJ_INCREF(buf);
+    buf->aio = true;
+    req->done = false;
+    req->res = 0;
+    my_qpush(&st->queue, req);
+    obj->nflight++;
+    return KENO_OK;
+}
+
+KATA_API s32
+kos_aio_poll(kos_aio obj) {
+    return my_step(obj, false);
+}
+
+KATA_API s32
+kos_aio_wait(kos_aio obj, s32 min) {
+    s32 res = 0;
+    do {
+        s32 rc = my_step(obj, obj->nflight > 0 && res < min);
+        if (rc < 0) return rc;
+        res += rc;
+    } while (res < min && obj->nflight > 0);
+    return res;
+}
+
+KATA_API ssize
+kos_aio_await(kos_aio obj, struct kos_aio_req* req) {
+    while (!req->done) {
+        // NOTE: if nothing is in flight, the request was never submitted
+        if (obj->nflight == 0 || my_step(obj, true) < 0) return -1;
+    }
+    return req->res;
+}
+
+KATA_API void
+kinit_os_aio() {
+    ktype_init(Kos_aio, sizeof(struct kos_aio), "os.aio", "Async IO engine, using io_uring or worker threads");
+
+    Kos_aio->c_del = my_del;
+}
@@ -0,0 +1,313 @@
+/* src/os/bufio.c - kio_bufio type implementation
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <errno.h>
+#include <sys/uio.h>
+
+/// INTERNALS ///
+
+// list of all buffered IO objects (see 'kio_flushall')
+// NOTE: the lock order is 'my_all_lock' first, and then the lock of a buffered IO object
+static struct kio_bufio* my_all = NULL;
+static pthread_mutex_t my_all_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// (internal) write all of 'data' to an IO object, returning 0 on success
+static keno
+my_writeall(kobj io, usize len, const u8* data) {
+    while (len > 0) {
+        ssize sz = kwrite(io, len, data);
+        if (sz <= 0) return -1;
+        data += sz;
+        len -= sz;
+    }
+    return 0;
+}
+
+// (internal) send all pending segments, returning 0 on success
+static keno
+my_send(kio_bufio obj) {
+    s32 i = 0, n = obj->nsegs;
+    if (KOBJ_TYPE(obj->io) != Kos_rawio) {
+        // no gather write, so send them one at a time
+        for (i = 0; i < n; ++i) {
+            if (my_writeall(obj->io, obj->segs[i].len, obj->segs[i].data) < 0) return -1;
+        }
+        return 0;
+    }
+
+    struct iovec iov[KIO_BUFIO_NSEG];
+    for (i = 0; i < n; ++i) {
+        iov[i].iov_base = (void*)obj->segs[i].data;
+        iov[i].iov_len = obj->segs[i].len;
+    }
+
+    s32 fd = ((kos_rawio)obj->io)->fd_;
+    i = 0;
+    while (i < n) {
+        ssize sz = writev(fd, iov + i, n - i);
+        if (sz < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+
+        // skip what was written, which may end in the middle of a segment
+        while (i < n && (usize)sz >= iov[i].iov_len) {
+            sz -= iov[i].iov_len;
+            i++;
+        }
+        if (i < n) {
+            iov[i].iov_base = (u8*)iov[i].iov_base + sz;
+            iov[i].iov_len -= sz;
+        }
+    }
+
+    return 0;
+}
+
+// (internal) 'kio_bufio_flush', with the lock held
+static keno
+my_flush(kio_bufio obj) {
+    if (obj->nsegs == 0) return 0;
+
+    // NOTE: the buffer is emptied even on error, so a broken stream doesn't keep failing
+    keno rc = my_send(obj);
+    obj->nsegs = 0;
+    obj->wlen = obj->slen = 0;
+    obj->borrowed = false;
+    if (rc < 0) return -1;
+
+    return kflush(obj->io);
+}
+
+// (internal) 'kio_bufio_read', with the lock held
+static ssize
+my_read(kio_bufio obj, usize len, u8* data) {
+    // pending writes go first, so prompts are shown before waiting on input
+    if (my_flush(obj) < 0) return -1;
+
+    if (obj->rpos >= obj->rlen) {
+        // large reads skip the buffer
+        if (len >= obj->cap) return kread(obj->io, len, data);
+
+        if (!obj->rbuf) {
+            obj->rbuf = kmem_make(obj->cap);
+            if (!obj->rbuf) return -1;
+        }
+
+        ssize sz = kread(obj->io, obj->cap, obj->rbuf);
+        if (sz <= 0) return sz;
+        obj->rpos = 0;
+        obj->rlen = sz;
+    }
+
+    // give what is buffered, which may be less than requested
+    usize rsz = obj->rlen - obj->rpos;
+    if (rsz > len) rsz = len;
+    memcpy(data, obj->rbuf + obj->rpos, rsz);
+    obj->rpos += rsz;
+    return rsz;
+}
+
+// (internal) 'kio_bufio_write', with the lock held
+static ssize
+my_write(kio_bufio obj, usize len, const u8* data, bool borrow) {
+    if (len == 0) return 0;
+    // NOTE: data written in a nested hold may be a temporary, which is freed before the
+    //         outermost hold is released, so it is copied
+    borrow = borrow && obj->hold == 1 && len >= KIO_BUFIO_BORROW;
+
+    if (borrow || len >= obj->cap) {
+        // reference the data, instead of copying it
+        if (obj->nsegs >= KIO_BUFIO_NSEG && my_flush(obj) < 0) return -1;
+        obj->segs[obj->nsegs].data = data;
+        obj->segs[obj->nsegs].len = len;
+        obj->nsegs++;
+        obj->slen += len;
+        if (borrow) obj->borrowed = true;
+
+        // large writes (that can't be borrowed) are sent right away, along with anything
+        //   before them
+        if (!borrow || obj->slen >= obj->cap || (obj->linebuf && memchr(data, '\n', len))) {
+            if (my_flush(obj) < 0) return -1;
+        }
+        return len;
+    }
+
+    // copy into the buffer, which continues the last segment if it was the end of the buffer
+    struct kio_seg* last = obj->nsegs > 0 ? &obj->segs[obj->nsegs - 1] : NULL;
+    bool cont = last && last->data + last->len == obj->wbuf + obj->wlen;
+    if (obj->wlen + len > obj->cap || (!cont && obj->nsegs >= KIO_BUFIO_NSEG)) {
+        if (my_flush(obj) < 0) return -1;
+        cont = false;
+    }
+
+    if (!obj->wbuf) {
+        obj->wbuf = kmem_make(obj->cap);
+        if (!obj->wbuf) return -1;
+    }
+
+    memcpy(obj->wbuf + obj->wlen, data, len);
+    if (cont) {
+        obj->segs[obj->nsegs - 1].len += len;
+    } else {
+        obj->segs[obj->nsegs].data = obj->wbuf + obj->wlen;
+        obj->segs[obj->nsegs].len = len;
+        obj->nsegs++;
+    }
+    obj->wlen += len;
+    obj->slen += len;
+
+    if (obj->linebuf && memchr(data, '\n', len)) {
+        if (my_flush(obj) < 0) return -1;
+    }
+
+    return len;
+}
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kio_bufio v = (kio_bufio)obj;
+
+    // NOTE: 'kio_flushall' may be flushing it (while holding 'my_all_lock'), so it is taken out
+    //         of the list first, after which no other thread can reach it, and then flushed
+    //         without taking its own lock
+    pthread_mutex_lock(&my_all_lock);
+    if (v->prev) v->prev->next = v->next;
+    else my_all = v->next;
+    if (v->next) v->next->prev = v->prev;
+    pthread_mutex_unlock(&my_all_lock);
+
+    my_flush(v);
+    pthread_mutex_destroy(&v->lock_);
+
+    kmem_free(v->wbuf);
+    kmem_free(v->rbuf);
+    KOBJ_DECREF(v->io);
+    kobj_del(obj);
+}
+
+// (internal) flush at exit
+static void
+my_atexit() {
+    kio_flushall();
+}
+
+
+/// C API ///
+
+KTYPE_DECL(Kio_bufio);
+
+KATA_API kio_bufio
+kio_bufio_new(kobj io, usize cap) {
+    kio_bufio obj = kobj_make(Kio_bufio);
+    if (!obj) return NULL;
+
+    KOBJ_INCREF(io);
+    obj->io = io;
+    obj->cap = cap > 0 ? cap : KIO_BUFIO_CAP;
+
+    // NOTE: buffers are allocated on first use
+    obj->wbuf = obj->rbuf = NULL;
+    obj->wlen = obj->rpos = obj->rlen = 0;
+    obj->nsegs = obj->hold = 0;
+    obj->slen = 0;
+    obj->borrowed = false;
+
+    // NOTE: recursive, since holds nest, and writes happen while held
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&obj->lock_, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    obj->linebuf = KOBJ_TYPE(io) == Kos_rawio && isatty(((kos_rawio)io)->fd_);
+
+    pthread_mutex_lock(&my_all_lock);
+    obj->prev = NULL;
+    obj->next = my_all;
+    if (my_all) my_all->prev = obj;
+    my_all = obj;
+    pthread_mutex_unlock(&my_all_lock);
+
+    return obj;
+}
+
+KATA_API ssize
+kio_bufio_read(kio_bufio obj, usize len, u8* data) {
+    pthread_mutex_lock(&obj->lock_);
+    ssize res = my_read(obj, len, data);
+    pthread_mutex_unlock(&obj->lock_);
+    return res;
+}
+
+KATA_API ssize
+kio_bufio_write(kio_bufio obj, usize len, const u8* data, bool borrow) {
+    pthread_mutex_lock(&obj->lock_);
+    ssize res = my_write(obj, len, data, borrow);
+    pthread_mutex_unlock(&obj->lock_);
+    return res;
+}
+
+KATA_API keno
+kio_bufio_flush(kio_bufio obj) {
+    pthread_mutex_lock(&obj->lock_);
+    keno res = my_flush(obj);
+    pthread_mutex_unlock(&obj->lock_);
+    return res;
+}
+
+KATA_API void
+kio_hold(kobj io) {
+    if (KOBJ_TYPE(io) != Kio_bufio) return;
+    kio_bufio obj = (kio_bufio)io;
+
+    // NOTE: the lock is kept until the matching release, so everything written while held
+    //         (i.e. a whole 'kprintf') comes out together, even with other threads writing
+    pthread_mutex_lock(&obj->lock_);
+    obj->hold++;
+}
+
+KATA_API keno
+kio_release(kobj io) {
+    if (KOBJ_TYPE(io) != Kio_bufio) return 0;
+    kio_bufio obj = (kio_bufio)io;
+
+    // NOTE: borrowed data is only valid until the outermost hold is released
+    keno res = 0;
+    if (--obj->hold == 0 && obj->borrowed) res = my_flush(obj);
+    pthread_mutex_unlock(&obj->lock_);
+    return res;
+}
+
+KATA_API void
+kio_flushall() {
+    // NOTE: this may be called again while flushing (i.e. from 'kexit'), so stop there
+    static KATA_TLS bool busy = false;
+    if (busy) return;
+    busy = true;
+
+    pthread_mutex_lock(&my_all_lock);
+    kio_bufio it;
+    for (it = my_all; it; it = it->next) {
+        kio_bufio_flush(it);
+    }
+    pthread_mutex_unlock(&my_all_lock);
+
+    busy = false;
+}
+
+KATA_API void
+kinit_os_bufio() {
+    ktype_init(Kio_bufio, sizeof(struct kio_bufio), "io.bufio", "Buffered IO, which wraps another IO object");
+
+    Kio_bufio->c_del = my_del;
+
+    atexit(my_atexit);
+}
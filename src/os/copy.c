@@ -0,0 +1,259 @@
+/* src/os/copy.c - copying between IO objects, in the kernel when possible
+ *
+ * When both ends are file descriptors, the data is moved with 'copy_file_range' (file to
+ *   file), 'sendfile' (file to anything), or 'splice' (to or from a pipe), so it never enters
+ *   user space. Otherwise, memory-backed ends are read or written in place, and anything
+ *   else goes through a reusable per-thread buffer
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#define _GNU_SOURCE
+#include <kata/impl.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+
+#ifdef __linux__
+  #include <sys/sendfile.h>
+#endif
+
+
+/// INTERNALS ///
+
+// size of the per-thread buffer, for copies the kernel can't do
+#define BUFSZ (256 * 1024)
+
+// most bytes asked of the kernel at once (which is what 'sendfile' is limited to anyway)
+#define CHUNK ((usize)0x7ffff000)
+
+// per-thread buffer (allocated on first use, and freed when the thread exits)
+static KATA_TLS u8* my_buf = NULL;
+
+// key used to get notified when a thread exits
+static pthread_key_t my_buf_key;
+static pthread_once_t my_buf_key_once = PTHREAD_ONCE_INIT;
+
+// (internal) ways of copying between descriptors, in the order they are tried
+enum {
+    MY_CFR = 0,
+    MY_SENDFILE,
+    MY_SPLICE,
+    MY_NONE,
+};
+
+// (internal) whether an error means the method doesn't work for these descriptors (as opposed
+//   to a real error)
+static bool
+my_unsupported(s32 err) {
+    return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP || err == EBADF
+        || err == ESPIPE;
+}
+
+// (internal) copy between file descriptors in the kernel, returning the number of bytes moved
+//   (stopping early at the end of input), or <0 on error
+// NOTE: '*how' is the method to try first, which is advanced to 'MY_NONE' if none of them work
+//         (and nothing has been moved)
+static ssize
+my_copyfd(s32 sfd, s32 dfd, usize len, s32* how) {
+#ifdef __linux__
+    usize res = 0;
+    while (res < len && *how < MY_NONE) {
+        usize n = len - res;
+        if (n > CHUNK) n = CHUNK;
+
+        ssize sz;
+        if (*how == MY_CFR) {
+            sz = copy_file_range(sfd, NULL, dfd, NULL, n, 0);
+        } else if (*how == MY_SENDFILE) {
+            sz = sendfile(dfd, sfd, NULL, n);
+        } else {
+            sz = splice(sfd, NULL, dfd, NULL, n, SPLICE_F_MOVE);
+        }
+
+        if (sz < 0) {
+            if (errno == EINTR) continue;
+            if (res == 0 && my_unsupported(errno)) {
+                (*how)++;
+                continue;
+            }
+            return res > 0 ? (ssize)res : -1;
+        } else if (sz == 0) {
+            // NOTE: some files (i.e. in '/proc') claim to be empty to 'copy_file_range', so
+            //         only believe the end of input from the other methods
+            if (res == 0 && *how == MY_CFR) {
+                (*how)++;
+                continue;
+            }
+            break;
+        }
+        res += sz;
+    }
+
+    return res;
+#else
+    *how = MY_NONE;
+    return 0;
+#endif
+}
+
+// (internal) write all of 'data', returning the number of bytes written (which is less than
+//   'len' on error)
+static usize
+my_writeall(kobj io, usize len, const u8* data) {
+    usize res = 0;
+    while (res < len) {
+        ssize sz = kwrite(io, len - res, data + res);
+        if (sz <= 0) break;
+        res += sz;
+    }
+    return res;
+}
+
+// (internal) called when a thread exits, to free its buffer
+static void
+my_buf_free(void* arg) {
+    kmem_free(arg);
+    my_buf = NULL;
+}
+
+// (internal) create the thread exit key
+static void
+my_buf_key_init() {
+    pthread_key_create(&my_buf_key, my_buf_free);
+}
+
+// (internal) get the current thread's buffer, or NULL if it could not be allocated
+static u8*
+my_buf_get() {
+    if (my_buf) return my_buf;
+
+    pthread_once(&my_buf_key_once, my_buf_key_init);
+    u8* buf = kmem_make(BUFSZ);
+    if (!buf) return NULL;
+    if (pthread_setspecific(my_buf_key, buf) != 0) {
+        kmem_free(buf);
+        return NULL;
+    }
+    return my_buf = buf;
+}
+
+// (internal) copy from buffered IO, where what has already been read goes first (which must
+//   be held)
+static ssize
+my_copybufio(kio_bufio src, kobj dst, ssize len) {
+    usize left = len < 0 ? (usize)-1 : (usize)len, res = 0;
+    if (kio_bufio_flush(src) < 0) return -1;
+
+    usize n = src->rlen - src->rpos;
+    if (n > left) n = left;
+    if (n > 0) {
+        res = my_writeall(dst, n, src->rbuf + src->rpos);
+        src->rpos += res;
+        if (res < n) return res > 0 ? (ssize)res : -1;
+        left -= n;
+    }
+    if (left == 0) return res;
+
+    ssize sz = kcopy(src->io, dst, len < 0 ? -1 : (ssize)left);
+    if (sz < 0) return res > 0 ? (ssize)res : -1;
+    return res + sz;
+}
+
+
+/// C API ///
+
+KATA_API ssize
+kcopy(kobj src, kobj dst, ssize len) {
+    usize left = len < 0 ? (usize)-1 : (usize)len, res = 0;
+    ktype stp = KOBJ_TYPE(src), dtp = KOBJ_TYPE(dst);
+
+    if (dtp == Kio_bufio) {
+        // pending writes go first, and then the rest bypasses the buffer
+        // NOTE: it is held throughout, so other threads' writes don't get in between
+        kio_hold(dst);
+        ssize sz = kio_bufio_flush((kio_bufio)dst) < 0 ? -1 : kcopy(src, ((kio_bufio)dst)->io, len);
+        if (kio_release(dst) < 0) return -1;
+        return sz;
+    } else if (stp == Kio_bufio) {
+        kio_hold(src);
+        ssize sz = my_copybufio((kio_bufio)src, dst, len);
+        if (kio_release(src) < 0) return -1;
+        return sz;
+    }
+
+
+    if (stp == Kos_mmap || stp == Kbuffer) {
+        // memory-backed source, so write straight from it
+        while (left > 0) {
+            usize n;
+            const u8* data;
+            if (stp == Kos_mmap) {
+                kos_mmap tsrc = (kos_mmap)src;
+                data = tsrc->data + tsrc->pos;
+                n = tsrc->len - tsrc->pos;
+            } else {
+                data = kbuffer_peek((kbuffer)src, &n);
+            }
+            if (n == 0) break;
+            if (n > left) n = left;
+
+            usize sz = my_writeall(dst, n, data);
+            if (stp == Kos_mmap) ((kos_mmap)src)->pos += sz;
+            else kbuffer_consume((kbuffer)src, sz);
+            res += sz;
+            left -= sz;
+            if (sz < n) return res > 0 ? (ssize)res : -1;
+        }
+        return res;
+    }
+
+    if (stp == Kos_rawio && dtp == Kos_rawio) {
+        s32 how = MY_CFR;
+        ssize sz = my_copyfd(((kos_rawio)src)->fd_, ((kos_rawio)dst)->fd_, left, &how);
+        if (sz < 0) return -1;
+        // NOTE: if no method worked, fall through and copy through memory
+        if (how < MY_NONE) return sz;
+    }
+
+    if (dtp == Kbuffer) {
+        // memory-backed destination, so read straight into it
+        kbuffer tdst = (kbuffer)dst;
+        while (left > 0) {
+            usize n = left < BUFSZ ? left : BUFSZ;
+            u8* data = kbuffer_reserve(tdst, &n);
+            if (!data) return res > 0 ? (ssize)res : -1;
+            // a full ring, so this is all that fits
+            if (n == 0) break;
+            if (n > left) n = left;
+
+            ssize sz = kread(src, n, data);
+            if (sz < 0) return res > 0 ? (ssize)res : -1;
+            if (sz == 0) break;
+            kbuffer_commit(tdst, sz);
+            res += sz;
+            left -= sz;
+        }
+        return res;
+    }
+
+    // anything else goes through the per-thread buffer
+    u8* buf = my_buf_get();
+    if (!buf) return -1;
+
+    while (left > 0) {
+        usize n = left < BUFSZ ? left : BUFSZ;
+        ssize sz = kread(src, n, buf);
+        if (sz < 0) return res > 0 ? (ssize)res : -1;
+        if (sz == 0) break;
+
+        usize wsz = my_writeall(dst, sz, buf);
+        res += wsz;
+        left -= wsz;
+        if (wsz < (usize)sz) return res > 0 ? (ssize)res : -1;
+    }
+
+    return res;
+}
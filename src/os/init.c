@@ -8,19 +8,31 @@
 
 /// C API ///
 
-kos_rawio
+kio_bufio
 Kos_stdout,
-Kos_stderr,
+Kos_stderr;
+kos_rawio
 Kos_stdin;
 
 
 KATA_API void
 kinit_os() {
     kinit_os_rawio();
+    kinit_os_bufio();
+    kinit_os_mmap();
+    kinit_os_aio();
 
     // wrap them
     Kos_stdin  = kos_rawio_newd(0);
-    Kos_stdout = kos_rawio_newd(1);
-    Kos_stderr = kos_rawio_newd(2);
+
+    // NOTE: the buffered IO objects take their own references to the raw IO objects
+    kos_rawio out = kos_rawio_newd(1), err = kos_rawio_newd(2);
+    Kos_stdout = kio_bufio_new((kobj)out, 0);
+    Kos_stderr = kio_bufio_new((kobj)err, 0);
+    KOBJ_DECREF(out);
+    KOBJ_DECREF(err);
+
+    // errors should show up right away
+    Kos_stderr->linebuf = true;
 
 }
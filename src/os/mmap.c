@@ -0,0 +1,91 @@
+/* src/os/mmap.c - kos_mmap type implementation
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/// INTERNALS ///
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kos_mmap v = (kos_mmap)obj;
+    munmap((void*)v->data, v->mapsz);
+    kobj_del(obj);
+}
+
+
+/// C API ///
+
+KTYPE_DECL(Kos_mmap);
+
+KATA_API kos_mmap
+kos_mmap_new(const char* path, u32 hints) {
+    s32 fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        KTHROW(Kexc, "failed to open '%s'", path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        KTHROW(Kexc, "failed to stat '%s'", path);
+        return NULL;
+    }
+
+    // NOTE: there is always at least one byte past the end, for the NUL-terminator
+    usize len = st.st_size, pg = sysconf(_SC_PAGESIZE);
+    usize mapsz = (len + 1 + pg - 1) / pg * pg;
+
+    // reserve zeroed memory first, and then map the file over the start of it, so that the
+    //   data is NUL-terminated even if the file ends at a page boundary
+    u8* base = mmap(NULL, mapsz, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        KTHROW(Kexc, "failed to map '%s'", path);
+        return NULL;
+    }
+    if (len > 0 && mmap(base, len, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED) {
+        munmap(base, mapsz);
+        close(fd);
+        KTHROW(Kexc, "failed to map '%s'", path);
+        return NULL;
+    }
+
+    // NOTE: the mapping keeps the file open
+    close(fd);
+
+    // hints are best effort, so errors are ignored
+    if (len > 0) {
+        if (hints & KOS_MMAP_SEQ) madvise(base, len, MADV_SEQUENTIAL);
+        if (hints & KOS_MMAP_RANDOM) madvise(base, len, MADV_RANDOM);
+        if (hints & KOS_MMAP_WILLNEED) madvise(base, len, MADV_WILLNEED);
+    }
+
+    kos_mmap obj = kobj_make(Kos_mmap);
+    if (!obj) {
+        munmap(base, mapsz);
+        return NULL;
+    }
+
+    obj->data = base;
+    obj->len = len;
+    obj->pos = 0;
+    obj->mapsz = mapsz;
+
+    return obj;
+}
+
+KATA_API void
+kinit_os_mmap() {
+    ktype_init(Kos_mmap, sizeof(struct kos_mmap), "os.mmap", "Read-only memory map of a file");
+
+    Kos_mmap->c_del = my_del;
+}
@@ -9,7 +9,7 @@
 
 /// C API ///
 
-struct ktype Kos_rawio_, *Kos_rawio = &Kos_rawio_;
+KTYPE_DECL(Kos_rawio);
 
 KATA_API kos_rawio
 kos_rawio_newd(s32 fd_) {
@@ -24,5 +24,6 @@ kos_rawio_newd(s32 fd_) {
 
 KATA_API void
 kinit_os_rawio() {
+    ktype_init(Kos_rawio, sizeof(struct kos_rawio), "os.rawio", "Raw IO, which wraps a file descriptor");
 
 }
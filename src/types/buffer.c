@@ -5,6 +5,14 @@
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kbuffer_done((kbuffer)obj);
+    kobj_del(obj);
+}
 
 
 /// C API ///
@@ -26,8 +34,9 @@ kbuffer_new(usize len, const u8* data) {
 
 KATA_API keno
 kbuffer_init(struct kbuffer* obj, usize len, const u8* data) {
-    obj->len = obj->cap = 0;
+    obj->len = obj->cap = obj->pos = 0;
     obj->data = NULL;
+    obj->ring = obj->aio = false;
     return kbuffer_push(obj, len, data);
 }
 
@@ -38,6 +47,21 @@ kbuffer_done(struct kbuffer* obj) {
 
 KATA_API keno
 kbuffer_push(struct kbuffer* obj, usize len, const u8* data) {
+    if (obj->ring) {
+        // rings have a fixed size, so it must all fit (in at most two pieces)
+        if (obj->cap - obj->len < len) return -1;
+        while (len > 0) {
+            usize n = len;
+            u8* dst = kbuffer_reserve(obj, &n);
+            if (n > len) n = len;
+            memcpy(dst, data, n);
+            kbuffer_commit(obj, n);
+            data += n;
+            len -= n;
+        }
+        return 0;
+    }
+
     // check if we need to reallocate
     if (obj->cap < obj->len + len) {
         if (kmem_growx((void**)&obj->data, &obj->cap, obj->len + len) < 0) {
@@ -61,14 +85,154 @@ kbuffer_pop(struct kbuffer* obj, usize len) {
     return 0;
 }
 
+KATA_API keno
+kbuffer_ring(struct kbuffer* obj, usize cap) {
+    usize len = obj->len > obj->pos ? obj->len - obj->pos : 0;
+    if (obj->ring) {
+        // NOTE: the unread data may wrap around, so it is copied in order below
+        len = obj->len;
+    }
+    if (cap < len || cap == 0) return -1;
+
+    u8* data = kmem_make(cap);
+    if (!data) return KENO_ERR_OOM;
+
+    usize n = 0;
+    while (n < len) {
+        usize m;
+        const u8* src = kbuffer_peek(obj, &m);
+        memcpy(data + n, src, m);
+        kbuffer_consume(obj, m);
+        n += m;
+    }
+
+    kmem_free(obj->data);
+    obj->data = data;
+    obj->cap = cap;
+    obj->pos = 0;
+    obj->len = len;
+    obj->ring = true;
+    return 0;
+}
+
+KATA_API u8*
+kbuffer_reserve(struct kbuffer* obj, usize* len) {
+    if (!obj->ring) {
+        if (obj->cap < obj->len + *len && !kmem_growx((void**)&obj->data, &obj->cap, obj->len + *len)) {
+            *len = 0;
+            return NULL;
+        }
+        *len = obj->cap - obj->len;
+        return obj->data + obj->len;
+    }
+
+    // NOTE: start over at the beginning when empty, so the span is as large as possible
+    if (obj->len == 0) obj->pos = 0;
+
+    usize w = obj->pos + obj->len;
+    if (w < obj->cap) {
+        // free space is after the data (and before it, which is the next span)
+        *len = obj->cap - w;
+    } else {
+        // data wraps around, so free space is between the end and start of it
+        w -= obj->cap;
+        *len = obj->pos - w;
+    }
+    return obj->data + w;
+}
+
+KATA_API void
+kbuffer_commit(struct kbuffer* obj, usize len) {
+    obj->len += len;
+}
+
+KATA_API const u8*
+kbuffer_peek(struct kbuffer* obj, usize* len) {
+    if (!obj->ring) {
+        *len = obj->len > obj->pos ? obj->len - obj->pos : 0;
+    } else {
+        *len = obj->cap - obj->pos < obj->len ? obj->cap - obj->pos : obj->len;
+    }
+    return obj->data + obj->pos;
+}
+
+KATA_API void
+kbuffer_consume(struct kbuffer* obj, usize len) {
+    obj->pos += len;
+    if (obj->ring) {
+        if (obj->pos >= obj->cap) obj->pos -= obj->cap;
+        obj->len -= len;
+    }
+}
+
 KATA_API kstr
 kbuffer_str(struct kbuffer* obj) {
-    return kstr_new(obj->len, obj->data);
+    if (!obj->ring) return kstr_new(obj->len, obj->data);
+
+    // unread data of a ring, which may wrap around
+    usize len1 = obj->cap - obj->pos < obj->len ? obj->cap - obj->pos : obj->len;
+    kstr res = kstr_builder(obj->len);
+    if (!res) return NULL;
+    u8* dst = kstr_reserve(res, obj->len);
+    if (!dst) {
+        KOBJ_DECREF(res);
+        return NULL;
+    }
+    memcpy(dst, obj->data + obj->pos, len1);
+    memcpy(dst + len1, obj->data, obj->len - len1);
+    kstr_commit(res, obj->len);
+    return kstr_seal(res);
 }
 
 KATA_API kstr
 kbuffer_strz(kbuffer obj) {
-    kstr res = kbuffer_str(obj);
+    if (KOBJ_ISIMMORTAL(obj) || KOBJ_REFC(obj) != 1 || !obj->data || obj->ring) {
+        kstr res = kbuffer_str(obj);
+        KOBJ_DECREF(obj);
+        return res;
+    }
+
+    // last reference, so the string can take the data (which needs room for a NUL-terminator)
+    if (obj->cap <= obj->len && !kmem_growx((void**)&obj->data, &obj->cap, obj->len + 1)) {
+        KOBJ_DECREF(obj);
+        return NULL;
+    }
+
+    // NOTE: the extra byte is so that the data can't be mistaken for inline data (which
+    //         would be right after the structure)
+    kstr res = kobj_makex(Kstr, sizeof(struct kstr) + 1);
+    if (!res) {
+        KOBJ_DECREF(obj);
+        return NULL;
+    }
+    res->lenb = obj->len;
+    res->data = obj->data;
+    res->src = NULL;
+    res->builder = res->rope = false;
+
+    obj->data = NULL;
+    obj->len = obj->cap = obj->pos = 0;
     KOBJ_DECREF(obj);
-    return res;
+
+    return kstr_seal(res);
+}
+
+static KCFUNC(kbuffer_del_) {
+    kbuffer obj;
+    KARGS("obj:!", &obj, Kbuffer);
+
+    my_del((kobj)obj);
+    return NULL;
+}
+
+
+KATA_API void
+kinit_buffer() {
+    ktype_init(Kbuffer, sizeof(struct kbuffer), "buffer", "Mutable byte buffer type");
+
+    ktype_merge(Kbuffer, KDICT_IKV(
+        { "__del", kfunc_new(kbuffer_del_, "buffer.__del(obj: buffer)", "") },
+    ));
+
+    Kbuffer->c_del = my_del;
 }
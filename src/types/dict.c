@@ -190,6 +190,64 @@ my_resize(struct kdict* obj, usize new_buks_len) {
     //return self->ents_len * S_HOLES_MAX >= self->len_real ? s_fill_holes(self) : true;
 }
 
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kdict d = (kdict)obj;
+
+    // free all entries
+    usize i, pos;
+    struct kdict_ent* ent;
+    KDICT_ITER(d, ent, i, pos, {
+        KOBJ_DECREF(ent->key);
+        KOBJ_DECREF(ent->val);
+    });
+
+    kmem_free(d->ents);
+    kmem_free(d->buks);
+
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    // TODO: faster ways to dump?
+    ssize rsz = 0, sz = kwrite(io, 1, "{");
+    if (sz < 0) return sz;
+    rsz += sz;
+
+    // emit list children
+    kdict d = (kdict)obj;
+
+    usize i, pos;
+    struct kdict_ent* ent;
+    KDICT_ITER(d, ent, i , pos, {
+        if (i > 0) {
+            sz = kwrite(io, 2, ", ");
+            if (sz < 0) return sz;
+            rsz += sz;
+        }
+    
+        sz = kwriteR(io, ent->key);
+        if (sz < 0) return sz;
+        rsz += sz;
+
+        sz = kwrite(io, 2, ": ");
+        if (sz < 0) return sz;
+        rsz += sz;
+
+        sz = kwriteR(io, ent->val);
+        if (sz < 0) return sz;
+        rsz += sz;
+    });
+   
+    sz = kwrite(io, 1, "}");
+    if (sz < 0) return sz;
+    rsz += sz;
+    return rsz;
+}
+
 /// C API ///
 
 KTYPE_DECL(Kdict);
@@ -239,7 +297,7 @@ kdict_merge(struct kdict* obj, struct kdict_ikv* ikv) {
     // iterate and add all elements
     struct kdict_ikv* it = ikv;
     while (it && it->key != NULL) {
-        kstr okey = kstr_new(-1, it->key);
+        kstr okey = kstr_intern(-1, it->key);
 
         if (!okey || kdict_setx(obj, (kobj)okey, okey->hash, it->val) < 0) {
             if (okey) KOBJ_DECREF(okey);
@@ -257,7 +315,7 @@ kdict_mergez(struct kdict* obj, struct kdict_ikv* ikv) {
     // iterate and add all elements
     struct kdict_ikv* it = ikv;
     while (it && it->key != NULL) {
-        kstr okey = kstr_new(-1, it->key);
+        kstr okey = kstr_intern(-1, it->key);
         if (!okey || kdict_setx(obj, (kobj)okey, okey->hash, it->val) < 0) {
             if (okey) KOBJ_DECREF(okey);
     
@@ -386,19 +444,7 @@ static KCFUNC(kdict_del_) {
     kdict obj;
     KARGS("obj:!", &obj, Kdict);
 
-    // free all entries
-    usize i, pos;
-    struct kdict_ent* ent;
-    KDICT_ITER(obj, ent, i, pos, {
-        KOBJ_DECREF(ent->key);
-        KOBJ_DECREF(ent->val);
-    });
-
-    kmem_free(obj->ents);
-    kmem_free(obj->buks);
-
-    kobj_del(obj);
-
+    my_del((kobj)obj);
     return NULL;
 }
 
@@ -410,5 +456,8 @@ kinit_dict() {
     ktype_merge(Kdict, KDICT_IKV(
         { "__del", kfunc_new(kdict_del_, "dict.__del(obj: dict)", "") },
     ));
+
+    Kdict->c_del = my_del;
+    Kdict->c_repr = my_repr;
 }
 
@@ -5,6 +5,47 @@
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kbf_done(&((kfloat)obj)->val);
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    // TODO: faster ways to dump?
+    size_t len;
+    // A few options for modes:
+    // BF_FTOA_FORMAT_FREE: free format, which is exact
+    // BF_FTOA_FORMAT_FREE_MIN: like above, but lowest number of digits
+    //
+    // should 'prec' be taken from the float, the current value, or infinite always?
+    //
+    // TODO: is 'len * bits_per_limb' correct? I assume it must be....
+    s64 prec = ((kfloat)obj)->val.len * LIMB_BITS;
+    char* data = bf_ftoa(&len, &((kfloat)obj)->val, 10, prec, BF_FTOA_FORMAT_FREE_MIN);
+    ssize res = kwrite(io, len, data);
+    kmem_free(data);
+    return res;
+}
+
+// (internal) 'c_hash' slot
+static bool
+my_hash(kobj obj, usize* res) {
+    *res = kbf_hash(&((kfloat)obj)->val);
+    return true;
+}
+
+// (internal) 'c_eq' slot
+static bool
+my_eq(kobj a, kobj b, bool* res) {
+    return kbf_eq(a, b, res);
+}
+
 
 /// C API ///
 
@@ -108,8 +149,7 @@ static KCFUNC(kfloat_del_) {
     kfloat obj;
     KARGS("obj:!", &obj, Kfloat);
 
-    bf_delete(&obj->val);
-    kobj_del(obj);
+    my_del((kobj)obj);
 
     return NULL;
 }
@@ -123,6 +163,16 @@ kinit_float() {
         { "__del", kfunc_new(kfloat_del_, "float.__del(obj: float)", "") },
     ));
 
+    Kfloat->c_del = my_del;
+    Kfloat->c_repr = my_repr;
+    Kfloat->c_hash = my_hash;
+    Kfloat->c_eq = my_eq;
+    Kfloat->c_add = kop_add_bf;
+    Kfloat->c_mul = kop_mul_bf;
+    Kfloat->c_div = kop_div_bf;
+    Kfloat->c_fdiv = kop_fdiv_bf;
+    Kfloat->c_pow = kop_pow_bf;
+
     Kfloat->is_float = true;
 
     Kfloat->bfpos = offsetof(struct kfloat, val);
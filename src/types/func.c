@@ -5,6 +5,19 @@
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
+
+// (internal) 'c_call' slot
+static kobj
+my_call(kobj fn, usize nargs, kobj* vargs) {
+    kfunc kfn = (kfunc)fn;
+    if (kfn->kind & KFUNC_CFUNC) {
+        return kfn->cfunc_(nargs, vargs);
+    }
+
+    kexit(-1);
+    return NULL;
+}
 
 
 /// C API ///
@@ -30,4 +43,5 @@ KATA_API void
 kinit_func() {
     ktype_init(Kfunc, sizeof(struct kfunc), "func", "Function type");
 
+    Kfunc->c_call = my_call;
 }
@@ -5,6 +5,90 @@
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
+
+// number of cached integers
+#define NCACHE (KATA_INT_CACHE_MAX - KATA_INT_CACHE_MIN + 1)
+
+// cache of small integers, which are statically allocated and immortal
+// NOTE: the cache is only used once 'my_cache_ok' is set, in 'kinit_int'
+#if NCACHE > 0
+static struct {
+    struct kobj_meta meta;
+    struct kint obj;
+} my_cache[NCACHE];
+#endif
+
+static bool my_cache_ok = false;
+
+// (internal) get a cached integer, or NULL if it is out of range
+static inline kint
+my_cached(s64 val) {
+#if NCACHE > 0
+    if (my_cache_ok && val >= KATA_INT_CACHE_MIN && val <= KATA_INT_CACHE_MAX) {
+        return &my_cache[val - KATA_INT_CACHE_MIN].obj;
+    }
+#endif
+    return NULL;
+}
+
+// (internal) make an integer with a small value
+static inline kint
+my_news(s64 val) {
+#if KATA_TAGGED
+    if (val >= KINT_TAG_MIN && val <= KINT_TAG_MAX) return (kint)KINT_TAG(val);
+#endif
+    kint res = my_cached(val);
+    if (res) return res;
+
+    kint obj = kobj_make(Kint);
+    if (!obj) return NULL;
+
+    obj->isbig = false;
+    obj->small = val;
+    return obj;
+}
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    if (((kint)obj)->isbig) kbf_done(&((kint)obj)->val);
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    if (KINT_ISSMALL(obj)) {
+        return kwrites(io, KINT_SMALL(obj), 10, 0, KWRITE_NONE);
+    }
+
+    // TODO: faster ways to dump?
+    size_t len;
+    char* data = bf_ftoa(&len, &((kint)obj)->val, 10, 0, BF_FTOA_FORMAT_FRAC);
+    ssize res = kwrite(io, len, data);
+    kmem_free(data);
+    return res;
+}
+
+// (internal) 'c_hash' slot
+static bool
+my_hash(kobj obj, usize* res) {
+    *res = KINT_ISSMALL(obj) ? kbf_hashs(KINT_SMALL(obj)) : kbf_hash(&((kint)obj)->val);
+    return true;
+}
+
+// (internal) 'c_eq' slot
+static bool
+my_eq(kobj a, kobj b, bool* res) {
+    if (KOBJ_TYPE(b) == Kint && KINT_ISSMALL(a) && KINT_ISSMALL(b)) {
+        *res = KINT_SMALL(a) == KINT_SMALL(b);
+        return true;
+    }
+
+    return kbf_eq(a, b, res);
+}
+
 
 /// C API ///
 
@@ -12,104 +96,114 @@ KTYPE_DECL(Kint);
 
 KATA_API kint
 kint_new(const char* val, s32 base) {
-    kint obj = kobj_make(Kint);
-    if (!obj) return NULL;
-
-    // init and set to string
-    kbf_init(&obj->val, NULL);
+    // parse, and then store it as small as possible
+    bf_t v;
+    kbf_init(&v, NULL);
     const char* next = NULL;
-    int rc = bf_atof(&obj->val, val, &next, base, BF_PREC_INF, 0);
+    int rc = bf_atof(&v, val, &next, base, BF_PREC_INF, 0);
     if (rc != 0) {
+        kbf_done(&v);
         kexit(-1);
         return NULL;
     }
-    if (bf_rint(&obj->val, BF_RNDD) != 0) {
-        kexit(-1);
-        return NULL;
-    }
-    
-    return obj;
+
+    return kint_newz(&v);
 }
 
 KATA_API kint
 kint_newu(u64 val) {
+    if (val <= INT64_MAX) return my_news((s64)val);
+
     kint obj = kobj_make(Kint);
     if (!obj) return NULL;
 
-    // init and set to string
+    // too big, so use libbf
+    obj->isbig = true;
     kbf_init(&obj->val, NULL);
     if (bf_set_ui(&obj->val, val) != 0) {
         kexit(-1);
         return NULL;
     }
-    if (bf_rint(&obj->val, BF_RNDD) != 0) {
-        kexit(-1);
-        return NULL;
-    }
 
     return obj;
 }
 
 KATA_API kint
 kint_news(s64 val) {
-    kint obj = kobj_make(Kint);
-    if (!obj) return NULL;
+    return my_news(val);
+}
 
-    // init and set to string
-    kbf_init(&obj->val, NULL);
-    if (bf_set_si(&obj->val, val) != 0) {
-        kexit(-1);
-        return NULL;
+KATA_API kint
+kint_newf(f64 val) {
+    // NOTE: the range is exclusive, since '(f64)INT64_MAX' rounds up to 2**63
+    if (val >= -9223372036854775808.0 && val < 9223372036854775808.0) {
+        // round down, without needing libm
+        s64 v = (s64)val;
+        if (v > val) v--;
+        return my_news(v);
     }
-    if (bf_rint(&obj->val, BF_RNDD) != 0) {
+
+    // too big (or not finite), so use libbf
+    bf_t v;
+    kbf_init(&v, NULL);
+    if (bf_set_float64(&v, val) != 0) {
+        kbf_done(&v);
         kexit(-1);
         return NULL;
     }
-    
-    return obj;
+
+    return kint_newz(&v);
 }
 
 KATA_API kint
-kint_newf(f64 val) {
-    kint obj = kobj_make(Kint);
-    if (!obj) return NULL;
-
-    // init and set to double (f64)
-    kbf_init(&obj->val, NULL);
-    if (bf_set_float64(&obj->val, val) != 0) {
+kint_newz(bf_t* val) {
+    // round down
+    if (bf_rint(val, BF_RNDD) != 0) {
+        kbf_done(val);
         kexit(-1);
         return NULL;
     }
-    if (bf_rint(&obj->val, BF_RNDD) != 0) {
-        kexit(-1);
-        return NULL;
+
+    // store small if possible
+    int64_t v;
+    if (bf_get_int64(&v, val, 0) == 0) {
+        kbf_done(val);
+        return my_news(v);
     }
-    
-    return obj;
-}
 
-KATA_API kint
-kint_newz(bf_t* val) {
     kint obj = kobj_make(Kint);
-    if (!obj) return NULL;
+    if (!obj) {
+        kbf_done(val);
+        return NULL;
+    }
 
+    obj->isbig = true;
     obj->val = *val;
+    return obj;
+}
 
-    // round down
-    if (bf_rint(&obj->val, BF_RNDD) != 0) {
-        kexit(-1);
-        return NULL;
+KATA_API bool
+kint_getbf(kint obj, bf_t* out) {
+    kbf_init(out, NULL);
+    if (!KINT_ISSMALL(obj)) {
+        if (bf_set(out, &obj->val) != 0) {
+            kbf_done(out);
+            return false;
+        }
+    } else {
+        if (bf_set_si(out, KINT_SMALL(obj)) != 0) {
+            kbf_done(out);
+            return false;
+        }
     }
-    
-    return obj;
+    return true;
 }
 
 static KCFUNC(kint_del_) {
     kint obj;
     KARGS("obj:!", &obj, Kint);
 
-    kbf_done(&obj->val);
-    kobj_del(obj);
+    my_del((kobj)obj);
     return NULL;
 }
 
@@ -122,10 +216,34 @@ kinit_int() {
         { "__del", kfunc_new(kint_del_, "int.__del(obj: int)", "") },
     ));
 
+    Kint->c_del = my_del;
+    Kint->c_repr = my_repr;
+    Kint->c_hash = my_hash;
+    Kint->c_eq = my_eq;
+    Kint->c_add = kop_add_bf;
+    Kint->c_mul = kop_mul_bf;
+    Kint->c_div = kop_div_bf;
+    Kint->c_fdiv = kop_fdiv_bf;
+    Kint->c_pow = kop_pow_bf;
+
     Kint->is_int = true;
     Kint->is_float = true;
 
-    Kint->bfpos = offsetof(struct kint, val);
+    // NOTE: small values have no libbf value, so 'kbf_const' handles integers itself
+    Kint->bfpos = -1;
+
+#if NCACHE > 0
+    // fill in the small integer cache
+    s64 i;
+    for (i = 0; i < NCACHE; ++i) {
+        my_cache[i].meta.type = Kint;
+        my_cache[i].meta.refc = KOBJ_IMMORTAL;
+
+        my_cache[i].obj.isbig = false;
+        my_cache[i].obj.small = KATA_INT_CACHE_MIN + i;
+    }
+    my_cache_ok = true;
+#endif
 
 }
 
@@ -5,6 +5,66 @@
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    klist l = (klist)obj;
+
+    // free all entries
+    usize i;
+    for (i = 0; i < l->len; ++i) {
+        KOBJ_DECREF(l->data[i]);
+    }
+
+    kmem_free(l->data);
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    // TODO: faster ways to dump?
+    ssize rsz = 0, sz = kwrite(io, 1, "[");
+    if (sz < 0) return sz;
+    rsz += sz;
+
+    // emit list children
+    klist l = (klist)obj;
+    usize i;
+    for (i = 0; i < l->len; ++i) {
+        if (i > 0) {
+            sz = kwrite(io, 2, ", ");
+            if (sz < 0) return sz;
+            rsz += sz;
+        }
+    
+        sz = kwriteR(io, l->data[i]);
+        if (sz < 0) return sz;
+        rsz += sz;
+    }
+
+    sz = kwrite(io, 1, "]");
+    if (sz < 0) return sz;
+    rsz += sz;
+    return rsz;
+}
+
+// (internal) 'c_eq' slot, which compares elementwise
+// NOTE: lists are mutable, so they have no 'c_hash'
+static bool
+my_eq(kobj a, kobj b, bool* res) {
+    klist la = (klist)a, lb = (klist)b;
+    *res = KOBJ_TYPE(b) == Klist && la->len == lb->len;
+
+    usize i;
+    for (i = 0; *res && i < la->len; ++i) {
+        if (!kobj_eq(la->data[i], lb->data[i], res)) return false;
+    }
+
+    return true;
+}
 
 
 /// C API ///
@@ -21,11 +81,6 @@ klist_new(usize len, kobj* data) {
         return NULL;
     }
 
-    if (klist_pushx(obj, len, data) < 0) {
-        KOBJ_DECREF(obj);
-        return NULL;
-    }
-
     return obj;
 }
 
@@ -71,9 +126,12 @@ KATA_API keno
 klist_pushx(struct klist* obj, usize len, kobj* vals) {
     // check if reallocation is needed
     if (obj->cap < obj->len + len) {
-        if (!kmem_growx((void**)&obj->data, &obj->cap, sizeof(kobj) * (obj->len + len))) {
+        // NOTE: 'kmem_growx' works in bytes, but 'cap' is in elements
+        usize capb = sizeof(kobj) * obj->cap;
+        if (!kmem_growx((void**)&obj->data, &capb, sizeof(kobj) * (obj->len + len))) {
             return -1;
         }
+        obj->cap = capb / sizeof(kobj);
     }
 
     // copy and increment references
@@ -90,9 +148,12 @@ KATA_API keno
 klist_pushz(struct klist* obj, usize len, kobj* vals) {
     // check if reallocation is needed
     if (obj->cap < obj->len + len) {
-        if (!kmem_growx((void**)&obj->data, &obj->cap, sizeof(kobj) * (obj->len + len))) {
+        // NOTE: 'kmem_growx' works in bytes, but 'cap' is in elements
+        usize capb = sizeof(kobj) * obj->cap;
+        if (!kmem_growx((void**)&obj->data, &capb, sizeof(kobj) * (obj->len + len))) {
             return -1;
         }
+        obj->cap = capb / sizeof(kobj);
     }
 
     // we have enough space, so just copy to the end
@@ -121,15 +182,7 @@ static KCFUNC(klist_del_) {
     klist obj;
     KARGS("obj:!", &obj, Klist);
 
-    // free all entries
-    usize i;
-    for (i = 0; i < obj->len; ++i) {
-        KOBJ_DECREF(obj->data[i]);
-    }
-
-    kmem_free(obj->data);
-    kobj_del(obj);
-
+    my_del((kobj)obj);
     return NULL;
 }
 
@@ -141,4 +194,8 @@ kinit_list() {
     ktype_merge(Klist, KDICT_IKV(
         { "__del", kfunc_new(klist_del_, "list.__del(obj: list)", "") },
     ));
+
+    Klist->c_del = my_del;
+    Klist->c_repr = my_repr;
+    Klist->c_eq = my_eq;
 }
@@ -5,6 +5,276 @@
 
 #include <kata/impl.h>
 
+#include <pthread.h>
+
+/// INTERNALS ///
+
+// table of interned strings (see 'kstr_intern'), which is open addressed with linear
+//   probing, and has a power of two capacity
+// NOTE: entries are never removed, since interned strings are immortal, and every thread takes
+//         the lock (so interning is contended, and should stay off hot paths)
+static kstr* my_itab = NULL;
+static usize my_itab_cap = 0, my_itab_len = 0;
+static pthread_mutex_t my_itab_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// concatenations shorter than this many bytes are copied, instead of making a rope
+#define ROPE_MIN 64
+
+// get the data stored as part of a string (i.e. right after the structure)
+#define INLINE(obj_) ((u8*)((obj_) + 1))
+
+// get the children of a rope, '[left, right]', which are stored as part of the string
+#define ROPE(obj_) ((kstr*)((obj_) + 1))
+
+// (internal) stack of strings, for walking ropes without recursion (which may be very deep,
+//   for a string built one piece at a time)
+struct my_stk {
+    kstr* data;
+    usize len, cap;
+    kstr local[32];
+};
+
+// (internal) initialize a stack
+static void
+my_stk_init(struct my_stk* st) {
+    st->data = st->local;
+    st->len = 0;
+    st->cap = sizeof(st->local) / sizeof(*st->local);
+}
+
+// (internal) free a stack
+static void
+my_stk_done(struct my_stk* st) {
+    if (st->data != st->local) kmem_free(st->data);
+}
+
+// (internal) push a string onto a stack, returning whether it succeeded
+static bool
+my_stk_push(struct my_stk* st, kstr obj) {
+    if (st->len >= st->cap) {
+        usize ncap = 2 * st->cap;
+        kstr* ndata = kmem_make(sizeof(*ndata) * ncap);
+        if (!ndata) return false;
+        memcpy(ndata, st->data, sizeof(*ndata) * st->len);
+        my_stk_done(st);
+        st->data = ndata;
+        st->cap = ncap;
+    }
+    st->data[st->len++] = obj;
+    return true;
+}
+
+// (internal) release a reference to a string, which frees unreferenced ropes one at a time
+//   instead of recursively
+static void
+my_release(kstr obj) {
+    struct my_stk st;
+    my_stk_init(&st);
+    my_stk_push(&st, obj);
+
+    while (st.len > 0) {
+        kstr s = st.data[--st.len];
+        if (s->rope && !KOBJ_ISIMMORTAL(s) && KOBJ_REFC(s) == 1) {
+            // last reference to a rope, so take over its references to the children
+            kstr* sub = ROPE(s);
+            if (!my_stk_push(&st, sub[0])) KOBJ_DECREF(sub[0]);
+            if (!my_stk_push(&st, sub[1])) KOBJ_DECREF(sub[1]);
+            kmem_free(s->data);
+            kobj_del((kobj)s);
+        } else {
+            KOBJ_DECREF(s);
+        }
+    }
+
+    my_stk_done(&st);
+}
+
+// (internal) make a new string, with a pre-calculated hash
+static kstr
+my_new(usize lenb, const char* data, usize hash) {
+    // validate, and count characters
+    usize lenc;
+    if (!kstr_utf8(lenb, (const u8*)data, &lenc)) {
+        KTHROW(Kexc, "invalid UTF-8 data");
+        return NULL;
+    }
+
+    kstr obj = kobj_makex(Kstr, sizeof(struct kstr) + (lenb + 1));
+    if (!obj) return NULL;
+
+    // fill in calculated hash
+    obj->hash = hash;
+
+    obj->lenb = lenb;
+    obj->lenc = lenc;
+
+    // TODO: memcpy requirement
+    obj->data = INLINE(obj);
+    obj->src = NULL;
+    obj->builder = obj->rope = false;
+    memcpy(obj->data, data, lenb);
+
+    // NUL-terminate the data
+    obj->data[lenb] = '\0';
+
+    return obj;
+}
+
+// (internal) find the slot in the intern table for a string, which is either the interned
+//   string or an empty slot
+// NOTE: the table must be locked, and have a nonzero capacity
+static kstr*
+my_itab_find(usize lenb, const char* data, usize hash) {
+    usize mask = my_itab_cap - 1, i = hash & mask;
+    while (true) {
+        kstr s = my_itab[i];
+        if (!s || (s->hash == hash && s->lenb == lenb && memcmp(s->data, data, lenb) == 0)) {
+            return &my_itab[i];
+        }
+        i = (i + 1) & mask;
+    }
+}
+
+// (internal) grow the intern table, so it is at most half full after another string is added
+// NOTE: the table must be locked
+static bool
+my_itab_grow() {
+    if (2 * (my_itab_len + 1) <= my_itab_cap) return true;
+
+    usize ocap = my_itab_cap, i;
+    kstr* otab = my_itab;
+
+    my_itab_cap = ocap ? 2 * ocap : 256;
+    my_itab = kmem_make(sizeof(*my_itab) * my_itab_cap);
+    if (!my_itab) {
+        my_itab = otab;
+        my_itab_cap = ocap;
+        return false;
+    }
+    memset(my_itab, 0, sizeof(*my_itab) * my_itab_cap);
+
+    // rehash existing entries
+    for (i = 0; i < ocap; ++i) {
+        kstr s = otab[i];
+        if (s) *my_itab_find(s->lenb, (const char*)s->data, s->hash) = s;
+    }
+
+    kmem_free(otab);
+    return true;
+}
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    kstr s = (kstr)obj;
+    if (s->rope) {
+        // rope, which may have been flattened while shared (see 'kstr_flat')
+        my_release(ROPE(s)[0]);
+        my_release(ROPE(s)[1]);
+        kmem_free(s->data);
+    } else if (s->src) {
+        // view of another object
+        KOBJ_DECREF(s->src);
+    } else if (s->data != INLINE(s)) {
+        // flattened rope, or appended to in place
+        kmem_free(s->data);
+    }
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot, which writes the string data escaped
+static ssize
+my_repr(kobj io, kobj obj) {
+    usize len = ((kstr)obj)->lenb;
+    const u8* data = KSTR_DATA((kstr)obj);
+
+    // total bytes written
+    ssize res = 0;
+
+    // internal buffer
+    #define TMP_LEN 272
+    // send every this many bytes
+    #define TMP_EVERY 256
+    u8 tmp[TMP_LEN];
+    usize tmpi = 0;
+
+    tmp[tmpi++] = '"';
+
+    // check the buffer
+    #define TMP_SEND() do { \
+        ssize rsz = kwrite(io, tmpi, tmp); \
+        if (rsz < 0) return rsz; \
+        res += rsz; \
+        tmpi = 0; \
+    } while (0)
+
+    // whether a byte is written as itself
+    #define PLAIN(b_) (Kescstr_len[b_] == 1 && Kescstr[b_][0] == (b_))
+
+    usize i = 0;
+    while (i < len) {
+        usize j = i;
+        while (j < len && PLAIN(data[j])) j++;
+
+        if (j - i >= KIO_BUFIO_BORROW) {
+            // long runs are written straight from the data, which a buffered IO may send
+            //   without copying (see 'kwriteg')
+            TMP_SEND();
+            ssize rsz = kwriteg(io, j - i, data + i);
+            if (rsz < 0) return rsz;
+            res += rsz;
+            i = j;
+        } else {
+            while (i < j) {
+                if (tmpi > TMP_EVERY) TMP_SEND();
+                tmp[tmpi++] = data[i++];
+            }
+        }
+
+        if (i < len) {
+            // take care of escaped bytes
+            // TODO: allow customization?
+            if (tmpi > TMP_EVERY) TMP_SEND();
+            u8 b = data[i++];
+            memcpy(tmp + tmpi, Kescstr[b], Kescstr_len[b]);
+            tmpi += Kescstr_len[b];
+        }
+    }
+
+    // send rest of data
+    tmp[tmpi++] = '"';
+    TMP_SEND();
+    return res;
+}
+
+// (internal) 'c_hash' slot, which is cached
+static bool
+my_hash(kobj obj, usize* res) {
+    *res = kstr_hash((kstr)obj);
+    return true;
+}
+
+// (internal) 'c_eq' slot
+static bool
+my_eq(kobj a, kobj b, bool* res) {
+    if (KOBJ_TYPE(b) != Kstr) {
+        *res = false;
+        return true;
+    }
+
+    // NOTE: hashes are only compared if both are already calculated
+    kstr sa = (kstr)a, sb = (kstr)b;
+    *res = sa == sb || (sa->lenb == sb->lenb && (!sa->hash || !sb->hash || sa->hash == sb->hash)
+        && memcmp(KSTR_DATA(sa), KSTR_DATA(sb), sa->lenb) == 0);
+    return true;
+}
+
+// (internal) 'c_add' slot, which concatenates strings
+static kobj
+my_add(kobj a, kobj b) {
+    return (kobj)kstr_fmt("%S%S", a, b);
+}
+
 
 /// C API ///
 
@@ -16,60 +286,304 @@ kstr_cmp(kstr a, kstr b) {
     // get minimum (i.e. safe) length
     usize min_len = a->lenb > b->lenb ? b->lenb : a->lenb;
     // compare valid bytes, which will include the NUL-terminator
-    s32 cv = memcmp(a->data, b->data, min_len+1);
+    s32 cv = memcmp(KSTR_DATA(a), KSTR_DATA(b), min_len+1);
     // return sign(cv)
     return cv < 0 ? -1 : (cv > 0 ? 1 : 0);
 }
 
 KATA_API kstr
 kstr_new(ssize lenb, const char* data) {
-    if (lenb < 0) lenb = strlen(data);
+    // pre-calculate the hash (and length, if needed)
+    usize hash;
+    if (lenb < 0) {
+        usize len;
+        hash = kmem_hashz(data, &len);
+        lenb = len;
+    } else {
+        hash = kmem_hash(lenb, data);
+    }
 
-    // pre-calculate the hash
-    usize hash = kmem_hash(lenb, data);
+    // NOTE: strings are not interned by default, see 'kstr_intern'
+    return my_new(lenb, data, hash);
+}
 
-    // TODO: intern strings
-    struct kobj_meta* meta = kmem_make(sizeof(struct kobj_meta) + sizeof(struct kstr) + (lenb + 1));
-    if (!meta) return NULL;
-    kstr obj = KOBJ_UNMETA(meta);
+KATA_API kstr
+kstr_intern(ssize lenb, const char* data) {
+    // pre-calculate the hash (and length, if needed)
+    usize hash;
+    if (lenb < 0) {
+        usize len;
+        hash = kmem_hashz(data, &len);
+        lenb = len;
+    } else {
+        hash = kmem_hash(lenb, data);
+    }
 
-    KOBJ_REFC(obj) = 1;
-    KOBJ_TYPE(obj) = Kstr;
+    pthread_mutex_lock(&my_itab_lock);
+    if (!my_itab_grow()) {
+        pthread_mutex_unlock(&my_itab_lock);
+        return NULL;
+    }
 
-    // fill in calculated hash
-    obj->hash = hash;
+    kstr* slot = my_itab_find(lenb, data, hash);
+    kstr res = *slot;
+    if (!res) {
+        // not interned yet, so add it
+        res = my_new(lenb, data, hash);
+        if (res) {
+            kobj_immortal((kobj)res);
+            *slot = res;
+            my_itab_len++;
+        }
+    }
+    pthread_mutex_unlock(&my_itab_lock);
+
+    // NOTE: interned strings are immortal, so there is no need for a reference
+    return res;
+}
+
+KATA_API kstr
+kstr_internz(kstr obj) {
+    kstr res = kstr_intern(obj->lenb, (const char*)KSTR_DATA(obj));
+    KOBJ_DECREF(obj);
+    return res;
+}
+
+KATA_API kstr
+kstr_concat(kstr a, kstr b) {
+    if (!b->lenb || !a->lenb) {
+        kstr res = b->lenb ? b : a;
+        KOBJ_INCREF(res);
+        return res;
+    }
+
+    usize lenb = a->lenb + b->lenb;
+    if (lenb < ROPE_MIN) {
+        // short enough to just copy
+        kstr res = kobj_makex(Kstr, sizeof(struct kstr) + (lenb + 1));
+        if (!res) return NULL;
+        res->lenb = lenb;
+        res->lenc = a->lenc + b->lenc;
+        res->data = INLINE(res);
+        res->src = NULL;
+        res->builder = res->rope = false;
+        memcpy(res->data, KSTR_DATA(a), a->lenb);
+        memcpy(res->data + a->lenb, KSTR_DATA(b), b->lenb);
+        res->data[lenb] = '\0';
+        res->hash = kmem_hash(lenb, res->data);
+        return res;
+    }
+
+    // make a rope, which holds references to both sides
+    // NOTE: the hash is calculated lazily, since it requires the data
+    kstr res = kobj_makex(Kstr, sizeof(struct kstr) + 2 * sizeof(kstr));
+    if (!res) return NULL;
+    res->lenb = lenb;
+    res->lenc = a->lenc + b->lenc;
+    res->hash = 0;
+    res->data = NULL;
+    res->src = NULL;
+    res->builder = false;
+    res->rope = true;
+    KOBJ_INCREF(a);
+    KOBJ_INCREF(b);
+    ROPE(res)[0] = a;
+    ROPE(res)[1] = b;
+    return res;
+}
+
+KATA_API kstr
+kstr_concatz(kstr a, kstr b) {
+    // NOTE: if there are any other references to 'a' (which includes 'b' being 'a'), it
+    //         can't be changed
+    if (a == b || KOBJ_ISIMMORTAL(a) || KOBJ_REFC(a) != 1) {
+        kstr res = kstr_concat(a, b);
+        KOBJ_DECREF(a);
+        return res;
+    }
+
+    const u8* bdata = KSTR_DATA(b);
+    u8* dst = kstr_reserve(a, b->lenb);
+    if (!dst) {
+        KOBJ_DECREF(a);
+        return NULL;
+    }
+
+    memcpy(dst, bdata, b->lenb);
+    dst[b->lenb] = '\0';
+    kstr_commit(a, b->lenb);
+    a->lenc += b->lenc;
+    return a;
+}
+
+KATA_API kstr
+kstr_view(kobj src, usize lenb, const u8* data) {
+    usize lenc;
+    if (!kstr_utf8(lenb, data, &lenc)) {
+        KTHROW(Kexc, "invalid UTF-8 data");
+        return NULL;
+    }
+
+    kstr obj = kobj_makex(Kstr, sizeof(struct kstr));
+    if (!obj) return NULL;
 
     obj->lenb = lenb;
-    // TODO: UTF-8 support
-    obj->lenc = lenb;
+    obj->lenc = lenc;
+    obj->hash = kmem_hash(lenb, data);
+    obj->data = (u8*)data;
+    KOBJ_INCREF(src);
+    obj->src = src;
+    obj->builder = obj->rope = false;
+    return obj;
+}
 
-    // TODO: memcpy requirement
-    memcpy(obj->data, data, lenb);
+KATA_API kstr
+kstr_builder(usize cap) {
+    kstr obj = kobj_makex(Kstr, sizeof(struct kstr) + (cap + 1));
+    if (!obj) return NULL;
 
-    // NUL-terminate the data
-    obj->data[lenb] = '\0';
+    obj->lenb = obj->lenc = 0;
+    obj->hash = 0;
+    obj->data = INLINE(obj);
+    obj->data[0] = '\0';
+    obj->src = NULL;
+    obj->builder = true;
+    obj->rope = false;
+    return obj;
+}
+
+KATA_API u8*
+kstr_reserve(kstr obj, usize len) {
+    assert(!KOBJ_ISIMMORTAL(obj) && KOBJ_REFC(obj) == 1);
+    u8* data = KSTR_DATA(obj);
+    if (obj->rope) {
+        // NOTE: this is the only reference, so nothing else can be reading the children
+        obj->rope = false;
+        my_release(ROPE(obj)[0]);
+        my_release(ROPE(obj)[1]);
+    }
+
+    // NOTE: always keep room for a NUL-terminator
+    usize sz = obj->lenb + len + 1;
+    if (data == INLINE(obj) || obj->src) {
+        // use the rest of the string's own allocation, if there is room
+        usize off = sizeof(struct kobj_meta) + sizeof(struct kstr), cap = obj->src ? 0 : kmem_sizeof(KOBJ_META(obj));
+        if (cap < off + sz) {
+            // otherwise, move the data out of the string (or the object it is a view of), so
+            //   it can grow
+            u8* ndata = kmem_make(kmem_nextcap(0, sz));
+            if (!ndata) return NULL;
+            memcpy(ndata, data, obj->lenb);
+            obj->data = ndata;
+            if (obj->src) {
+                KOBJ_DECREF(obj->src);
+                obj->src = NULL;
+            }
+        }
+    } else if (kmem_sizeof(data) < sz) {
+        // grow geometrically, so repeated appends take amortized linear time
+        if (!kmem_grow((void**)&obj->data, kmem_nextcap(kmem_sizeof(data), sz))) return NULL;
+    }
+
+    return obj->data + obj->lenb;
+}
 
+KATA_API void
+kstr_commit(kstr obj, usize len) {
+    obj->lenb += len;
+    obj->hash = 0;
+}
+
+KATA_API kstr
+kstr_seal(kstr obj) {
+    usize lenc;
+    if (!kstr_utf8(obj->lenb, obj->data, &lenc)) {
+        KOBJ_DECREF(obj);
+        KTHROW(Kexc, "invalid UTF-8 data");
+        return NULL;
+    }
+
+    obj->data[obj->lenb] = '\0';
+    obj->lenc = lenc;
+    obj->hash = kmem_hash(obj->lenb, obj->data);
+    obj->builder = false;
     return obj;
 }
 
+KATA_API u8*
+kstr_flat(kstr obj) {
+    u8* res = __atomic_load_n(&obj->data, __ATOMIC_ACQUIRE);
+    if (res) return res;
+
+    u8* data = kmem_make(obj->lenb + 1);
+    if (!data) kexit(KENO_ERR_OOM);
+    data[obj->lenb] = '\0';
+
+    // copy the leaves right to left, so only left children are kept on the stack
+    struct my_stk st;
+    my_stk_init(&st);
+    usize pos = obj->lenb;
+    kstr s = obj;
+    while (true) {
+        const u8* sdata = __atomic_load_n(&s->data, __ATOMIC_ACQUIRE);
+        if (sdata) {
+            pos -= s->lenb;
+            memcpy(data + pos, sdata, s->lenb);
+            if (st.len == 0) break;
+            s = st.data[--st.len];
+        } else {
+            if (!my_stk_push(&st, ROPE(s)[0])) kexit(KENO_ERR_OOM);
+            s = ROPE(s)[1];
+        }
+    }
+    my_stk_done(&st);
+    assert(pos == 0);
+
+    // publish the data, unless another thread flattened the string first
+    // NOTE: the children aren't needed anymore, but other threads may still be reading them,
+    //         so they are kept until the string is freed
+    if (!__atomic_compare_exchange_n(&obj->data, &res, data, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        kmem_free(data);
+        return res;
+    }
+    return data;
+}
+
+KATA_API usize
+kstr_hash(kstr obj) {
+    // NOTE: threads racing to set the hash all store the same value
+    usize res = __atomic_load_n(&obj->hash, __ATOMIC_RELAXED);
+    if (!res) {
+        res = kmem_hash(obj->lenb, KSTR_DATA(obj));
+        __atomic_store_n(&obj->hash, res, __ATOMIC_RELAXED);
+    }
+    return res;
+}
+
 KATA_API kstr
 kstr_fmt(const char* fmt, ...) {
-    kbuffer io = kbuffer_new(0, NULL);
-    if (!io) return NULL;
+    // format directly into the string, which is usually a single allocation
+    kstr res = kstr_builder(64);
+    if (!res) return NULL;
     va_list ap;
     va_start(ap, fmt);
-    ssize sz = kprintfv(io, fmt, ap);
+    ssize sz = kprintfv((kobj)res, fmt, ap);
     va_end(ap);
     if (sz < 0) {
-        KOBJ_DECREF(io);
+        KOBJ_DECREF(res);
         return NULL;
     }
 
-    return kbuffer_strz(io);
+    return kstr_seal(res);
 }
 
 KATA_API void
 kinit_str() {
     ktype_init(Kstr, sizeof(struct kstr), "str", "String type");
 
+    Kstr->c_del = my_del;
+    Kstr->c_repr = my_repr;
+    Kstr->c_hash = my_hash;
+    Kstr->c_eq = my_eq;
+    Kstr->c_add = my_add;
 }
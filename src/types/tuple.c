@@ -5,6 +5,87 @@
 
 #include <kata/impl.h>
 
+/// INTERNALS ///
+
+// (internal) 'c_del' slot
+static void
+my_del(kobj obj) {
+    ktuple t = (ktuple)obj;
+
+    // free all entries
+    usize i;
+    for (i = 0; i < t->len; ++i) {
+        KOBJ_DECREF(t->data[i]);
+    }
+
+    kobj_del(obj);
+}
+
+// (internal) 'c_repr' slot
+static ssize
+my_repr(kobj io, kobj obj) {
+    ssize rsz = 0, sz = kwrite(io, 1, "(");
+    if (sz < 0) return sz;
+    rsz += sz;
+
+    // emit tuple children
+    ktuple t = (ktuple)obj;
+    usize i;
+    for (i = 0; i < t->len; ++i) {
+        if (i > 0) {
+            sz = kwrite(io, 2, ", ");
+            if (sz < 0) return sz;
+            rsz += sz;
+        }
+    
+        sz = kwriteR(io, t->data[i]);
+        if (sz < 0) return sz;
+        rsz += sz;
+    }
+    // to differentiate from a (...) grouping
+    if (t->len == 1) {
+        sz = kwrite(io, 2, ", ");
+        if (sz < 0) return sz;
+        rsz += sz;
+    }
+
+    sz = kwrite(io, 1, ")");
+    if (sz < 0) return sz;
+    rsz += sz;
+    return rsz;
+}
+
+// (internal) 'c_hash' slot, which combines the hashes of the elements
+static bool
+my_hash(kobj obj, usize* res) {
+    ktuple t = (ktuple)obj;
+    struct kmem_hasher hs;
+    kmem_hasher_init(&hs);
+
+    usize i, h;
+    for (i = 0; i < t->len; ++i) {
+        if (!kobj_hash(t->data[i], &h)) return false;
+        kmem_hasher_update(&hs, sizeof(h), (const u8*)&h);
+    }
+
+    *res = kmem_hasher_final(&hs);
+    return true;
+}
+
+// (internal) 'c_eq' slot, which compares elementwise
+static bool
+my_eq(kobj a, kobj b, bool* res) {
+    ktuple ta = (ktuple)a, tb = (ktuple)b;
+    *res = KOBJ_TYPE(b) == Ktuple && ta->len == tb->len;
+
+    usize i;
+    for (i = 0; *res && i < ta->len; ++i) {
+        if (!kobj_eq(ta->data[i], tb->data[i], res)) return false;
+    }
+
+    return true;
+}
+
 
 /// C API ///
 
@@ -26,13 +107,9 @@ ktuple_new(usize len, kobj* data) {
 KATA_API ktuple
 ktuple_newz(usize len, kobj* data) {
     // allocate enough memory to hold the pointers too
-    struct kobj_meta* meta = kmem_make(sizeof(struct kobj_meta) + sizeof(struct ktuple) + sizeof(kobj) * len);
-    if (!meta) return NULL;
-    
-    meta->refc = 1;
-    meta->type = Ktuple;
+    ktuple obj = kobj_makex(Ktuple, sizeof(struct ktuple) + sizeof(kobj) * len);
+    if (!obj) return NULL;
 
-    ktuple obj = KOBJ_UNMETA(meta);
     // copy over elements
     obj->len = len;
     usize i;
@@ -47,13 +124,7 @@ static KCFUNC(ktuple_del_) {
     ktuple obj;
     KARGS("obj:!", &obj, Ktuple);
 
-    // free all entries
-    usize i;
-    for (i = 0; i < obj->len; ++i) {
-        KOBJ_DECREF(obj->data[i]);
-    }
-
-    kobj_del(obj);
+    my_del((kobj)obj);
     return NULL;
 }
 
@@ -65,5 +136,10 @@ kinit_tuple() {
     ktype_merge(Ktuple, KDICT_IKV(
         { "__del", kfunc_new(ktuple_del_, "tuple.__del(obj: tuple)", "") },
     ));
+
+    Ktuple->c_del = my_del;
+    Ktuple->c_repr = my_repr;
+    Ktuple->c_hash = my_hash;
+    Ktuple->c_eq = my_eq;
 }
 
@@ -11,26 +11,42 @@
 
 KTYPE_DECL(Ktype);
 
+// next type id to give out (see 'ktype.id')
+static s32 my_nextid = 1;
+
 KATA_API void
 ktype_init(ktype tp, s32 sz, const char* name, const char* docs) {
     assert(tp != NULL);
     struct kobj_meta* meta = KOBJ_META(tp);
 
     meta->type = Ktype;
-    meta->refc = 1;
+    meta->refc = KOBJ_IMMORTAL;
 
     // by default, no bf_t
     tp->bfpos = -1;
 
+    // give out ids until the dispatch table is full
+    tp->id = 0;
+    s32 id = __atomic_fetch_add(&my_nextid, 1, __ATOMIC_RELAXED);
+    if (id < KTYPE_MAXID) tp->id = id;
+    tp->st_idx = id;
+
     tp->sz = sz;
     tp->attr = kdict_new(NULL);
     assert(tp->attr != NULL);
     
-    tp->name = kstr_new(-1, name);
+    tp->name = kstr_intern(-1, name);
     assert(tp->name != NULL);
     tp->docs = kstr_new(-1, docs);
     assert(tp->docs != NULL);
 
+    // keep track of all types, for statistics
+    // NOTE: builtin types are made before 'Ktypes', and are added in 'kinit'
+    if (Ktypes) {
+        bool ok = klist_push(Ktypes, (kobj)tp);
+        assert(ok);
+    }
+
 }
 
 KATA_API void
@@ -38,15 +54,19 @@ ktype_merge(ktype tp, struct kdict_ikv* ikv) {
     assert(ikv != NULL);
     struct kdict_ikv* it = ikv;
     while (ikv->key != NULL) {
-        kstr key = kstr_new(-1, ikv->key);
+        kstr key = kstr_intern(-1, ikv->key);
         assert(key != NULL);
 
         // TODO: check for particular values?
         // TODO: use a hash table?
-        if (kstr_cmp(key, Ksc_del) == 0) {
+        // NOTE: keys are interned, so they can be compared by pointer
+        // NOTE: this replaces any C slot, so the new function is used
+        if (key == Ksc_del) {
             tp->fn_del = ikv->val;
-        } else if (kstr_cmp(key, Ksc_repr) == 0) {
+            tp->c_del = NULL;
+        } else if (key == Ksc_repr) {
             tp->fn_repr = ikv->val;
+            tp->c_repr = NULL;
         }
 
         // always set manually to the dictionary
@@ -0,0 +1,314 @@
+/* src/types/utf8.c - UTF-8 validation and character counting (see 'kstr_utf8')
+ *
+ * there are a few implementations, which are picked at runtime based on the CPU:
+ *
+ *   * AVX2: validates 32 bytes at a time with the lookup algorithm, which classifies each
+ *             pair of adjacent bytes with 3 table lookups (on the high and low nibble of the
+ *             previous byte, and the high nibble of the current byte), and checks that 3 and 4
+ *             byte sequences have the right number of continuation bytes
+ *   * SSE2: skips (and counts) ASCII 16 bytes at a time, and validates anything else bytewise
+ *   * scalar: skips ASCII a word at a time, and validates anything else bytewise
+ *
+ * characters are counted as the number of bytes which aren't continuation bytes (10xxxxxx)
+ *
+ * SEE: https://arxiv.org/abs/2010.03090 (Validating UTF-8 In Less Than One Instruction Per Byte)
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/impl.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  #define MY_X86 1
+  #include <immintrin.h>
+#else
+  #define MY_X86 0
+#endif
+
+/// INTERNALS ///
+
+// (internal) get the length of the valid UTF-8 sequence starting at 'data[i]', or 0 if it is
+//   not valid
+static inline usize
+my_seq(usize lenb, const u8* data, usize i) {
+    u8 b = data[i];
+    if (b < 0x80) return 1;
+
+    // number of continuation bytes, and the valid range of the first one (which rules out
+    //   overlong encodings, surrogates, and codepoints past U+10FFFF)
+    usize n;
+    u8 lo = 0x80, hi = 0xBF;
+    if (b < 0xC2) return 0;
+    else if (b < 0xE0) n = 1;
+    else if (b < 0xF0) {
+        n = 2;
+        if (b == 0xE0) lo = 0xA0;
+        else if (b == 0xED) hi = 0x9F;
+    } else if (b < 0xF5) {
+        n = 3;
+        if (b == 0xF0) lo = 0x90;
+        else if (b == 0xF4) hi = 0x8F;
+    } else return 0;
+
+    if (i + n >= lenb) return 0;
+    if (data[i + 1] < lo || data[i + 1] > hi) return 0;
+
+    usize j;
+    for (j = 2; j <= n; ++j) {
+        if ((data[i + j] & 0xC0) != 0x80) return 0;
+    }
+
+    return n + 1;
+}
+
+// (internal) validate a single sequence at 'data[*pi]', advancing '*pi' and '*plenc'
+static inline bool
+my_step(usize lenb, const u8* data, usize* pi, usize* plenc) {
+    usize n = my_seq(lenb, data, *pi);
+    if (!n) return false;
+    *pi += n;
+    (*plenc)++;
+    return true;
+}
+
+// (internal) scalar implementation
+static bool
+my_utf8_scalar(usize lenb, const u8* data, usize* lenc) {
+    usize i = 0, res = 0;
+    while (i < lenb) {
+        // skip ASCII a word at a time
+        if (i + 8 <= lenb) {
+            u64 w;
+            memcpy(&w, data + i, sizeof(w));
+            if (!(w & 0x8080808080808080ull)) {
+                i += 8;
+                res += 8;
+                continue;
+            }
+        }
+
+        if (!my_step(lenb, data, &i, &res)) return false;
+    }
+
+    *lenc = res;
+    return true;
+}
+
+#if MY_X86 && defined(__SSE2__)
+
+// (internal) SSE2 implementation
+static bool
+my_utf8_sse2(usize lenb, const u8* data, usize* lenc) {
+    usize i = 0, res = 0;
+    while (i + 16 <= lenb) {
+        __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+        if (!_mm_movemask_epi8(v)) {
+            // all ASCII
+            i += 16;
+            res += 16;
+            continue;
+        }
+
+        // validate sequences until the end of the block (which may go a bit past it)
+        usize end = i + 16;
+        while (i < end) {
+            if (!my_step(lenb, data, &i, &res)) return false;
+        }
+    }
+
+    // finish the rest
+    while (i < lenb) {
+        if (!my_step(lenb, data, &i, &res)) return false;
+    }
+
+    *lenc = res;
+    return true;
+}
+
+#endif
+
+#if MY_X86
+
+// error bits for the lookup algorithm, for a pair of bytes (previous, current)
+#define TOO_SHORT   (1 << 0) // 11______ 0_______ and 11______ 11______
+#define TOO_LONG    (1 << 1) // 0_______ 10______
+#define OVERLONG_3  (1 << 2) // 11100000 100_____
+#define TOO_LARGE   (1 << 3) // 11110100 1001____ (and larger)
+#define SURROGATE   (1 << 4) // 11101101 101_____
+#define OVERLONG_2  (1 << 5) // 1100000_ 10______
+#define TOO_LARGE_1000 (1 << 6) // 11110101 1000____ (and larger)
+#define OVERLONG_4  (1 << 6) // 11110000 1000____
+#define TWO_CONTS   (1 << 7) // 10______ 10______
+
+// errors which only depend on the high nibble of the previous byte
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+// (internal) get 'cur' shifted by 'n' bytes, with the bytes shifted in from 'prev'
+#define PREVN(cur_, prev_, n_) _mm256_alignr_epi8((cur_), _mm256_permute2x128_si256((prev_), (cur_), 0x21), 16 - (n_))
+
+// (internal) AVX2 implementation
+__attribute__((target("avx2")))
+static bool
+my_utf8_avx2(usize lenb, const u8* data, usize* lenc) {
+    // lookup tables, which are repeated in both 128 bit lanes
+    const __m256i t1h = _mm256_setr_epi8(
+        // 0_______ ________ (ASCII)
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        // 10______ ________ (continuation)
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        // 1100____ ________, 1101____ ________ (2 byte lead)
+        TOO_SHORT | OVERLONG_2, TOO_SHORT,
+        // 1110____ ________ (3 byte lead)
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        // 1111____ ________ (4 byte lead)
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4,
+
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        TOO_SHORT | OVERLONG_2, TOO_SHORT,
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+    );
+    const __m256i t1l = _mm256_setr_epi8(
+        // ____0000 ________
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        // ____0001 ________
+        CARRY | OVERLONG_2,
+        // ____001_ ________
+        CARRY, CARRY,
+        // ____0100 ________
+        CARRY | TOO_LARGE,
+        // ____0101 ________, ____011_ ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        // ____1___ ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        // ____1101 ________
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY, CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000, CARRY | TOO_LARGE | TOO_LARGE_1000
+    );
+    const __m256i t2h = _mm256_setr_epi8(
+        // ________ 0_______ (ASCII)
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        // ________ 1000____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        // ________ 1001____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        // ________ 101_____
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        // ________ 11______
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+    );
+
+    // for checking whether the end of a block has an unfinished sequence
+    const __m256i maxv = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        0xF0 - 1, 0xE0 - 1, 0xC0 - 1
+    );
+
+    const __m256i lo4 = _mm256_set1_epi8(0x0F);
+    const __m256i cont = _mm256_set1_epi8(-64);
+
+    __m256i err = _mm256_setzero_si256(), prev = _mm256_setzero_si256(), previnc = _mm256_setzero_si256();
+    usize i = 0, nconts = 0;
+    u8 tail[32];
+
+    while (i < lenb) {
+        __m256i v;
+        if (i + 32 <= lenb) {
+            v = _mm256_loadu_si256((const __m256i*)(data + i));
+        } else {
+            // pad the last block with ASCII
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, data + i, lenb - i);
+            v = _mm256_loadu_si256((const __m256i*)tail);
+        }
+
+        u32 hib = (u32)_mm256_movemask_epi8(v);
+        if (!hib) {
+            // all ASCII, so just make sure the previous block didn't end with an unfinished sequence
+            err = _mm256_or_si256(err, previnc);
+        } else {
+            // classify each byte with the byte before it
+            __m256i prev1 = PREVN(v, prev, 1);
+            __m256i b1h = _mm256_shuffle_epi8(t1h, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), lo4));
+            __m256i b1l = _mm256_shuffle_epi8(t1l, _mm256_and_si256(prev1, lo4));
+            __m256i b2h = _mm256_shuffle_epi8(t2h, _mm256_and_si256(_mm256_srli_epi16(v, 4), lo4));
+            __m256i sc = _mm256_and_si256(_mm256_and_si256(b1h, b1l), b2h);
+
+            // the third and fourth bytes of sequences must be continuations (which show up
+            //   as 'TWO_CONTS'), and nothing else may be
+            __m256i prev2 = PREVN(v, prev, 2), prev3 = PREVN(v, prev, 3);
+            __m256i is3 = _mm256_subs_epu8(prev2, _mm256_set1_epi8(0xE0 - 0x80));
+            __m256i is4 = _mm256_subs_epu8(prev3, _mm256_set1_epi8(0xF0 - 0x80));
+            __m256i must = _mm256_and_si256(_mm256_or_si256(is3, is4), _mm256_set1_epi8(0x80));
+            err = _mm256_or_si256(err, _mm256_xor_si256(must, sc));
+
+            previnc = _mm256_subs_epu8(v, maxv);
+
+            // count continuation bytes, which are less than -64 as signed bytes
+            nconts += __builtin_popcount((u32)_mm256_movemask_epi8(_mm256_cmpgt_epi8(cont, v)));
+        }
+
+        prev = v;
+        i += 32;
+    }
+
+    // the input may not end with an unfinished sequence
+    err = _mm256_or_si256(err, previnc);
+    if (!_mm256_testz_si256(err, err)) return false;
+
+    *lenc = lenb - nconts;
+    return true;
+}
+
+#endif
+
+// implementation to use, which is picked on first use
+static bool (*my_utf8)(usize lenb, const u8* data, usize* lenc) = NULL;
+
+// (internal) pick the best implementation for this CPU
+static void
+my_pick() {
+#if MY_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        my_utf8 = my_utf8_avx2;
+        return;
+    }
+  #ifdef __SSE2__
+    my_utf8 = my_utf8_sse2;
+    return;
+  #endif
+#endif
+    my_utf8 = my_utf8_scalar;
+}
+
+
+/// C API ///
+
+KATA_API bool
+kstr_utf8(usize lenb, const u8* data, usize* lenc) {
+    // NOTE: racing threads pick the same implementation
+    if (!my_utf8) my_pick();
+    return my_utf8(lenb, data, lenc);
+}
@@ -0,0 +1,133 @@
+/* test/aio.c - testing async IO ('kos_aio')
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/test.h>
+
+#include <unistd.h>
+#include <errno.h>
+
+// number of reads in flight at once
+#define NREQS 200
+
+// size of each read
+#define RSZ 1000
+
+// callback which counts completions
+static void
+my_cb(struct kos_aio_req* req) {
+    (*(s32*)req->user)++;
+}
+
+// run tests with a given backend
+static void
+my_test(s32 mode, s32 fd) {
+    kos_aio aio = kos_aio_new(32, mode);
+    if (!aio) {
+        // io_uring may not be available (or allowed) here
+        assert(mode == KOS_AIO_URING);
+        return;
+    }
+    assert(mode == KOS_AIO_AUTO || aio->mode == mode);
+
+    // many positional reads in flight at once, which is more than the depth
+    static struct kos_aio_req reqs[NREQS];
+    s32 i, j, ndone = 0;
+    for (i = 0; i < NREQS; ++i) {
+        reqs[i].kind = KOS_AIO_READ;
+        reqs[i].fd = fd;
+        reqs[i].off = (s64)(NREQS - 1 - i) * RSZ;
+        reqs[i].buf = kbuffer_new(0, NULL);
+        reqs[i].len = RSZ;
+        reqs[i].cb = my_cb;
+        reqs[i].user = &ndone;
+        assert(kos_aio_submit(aio, &reqs[i]) == KENO_OK);
+    }
+    assert(aio->nflight == NREQS);
+    assert(kos_aio_wait(aio, NREQS) == NREQS);
+    assert(ndone == NREQS && aio->nflight == 0);
+    for (i = 0; i < NREQS; ++i) {
+        assert(reqs[i].done && reqs[i].res == RSZ);
+        kbuffer buf = reqs[i].buf;
+        assert(buf->len == RSZ && buf->pos == RSZ);
+        for (j = 0; j < RSZ; ++j) {
+            usize k = (usize)reqs[i].off + j;
+            assert(buf->data[j] == (u8)(k * 7 + k / 256));
+        }
+        KOBJ_DECREF(buf);
+    }
+
+    // writes and reads through a pipe, using the current position
+    int fds[2];
+    assert(pipe(fds) == 0);
+    struct kos_aio_req w = { .kind = KOS_AIO_WRITE, .fd = fds[1], .off = -1, .len = 5 };
+    w.buf = kbuffer_new(10, (const u8*)"helloworld");
+    w.buf->pos = 0;
+    assert(kos_aio_submit(aio, &w) == KENO_OK);
+    assert(kos_aio_await(aio, &w) == 5 && w.buf->pos == 5);
+    assert(kos_aio_submit(aio, &w) == KENO_OK);
+    assert(kos_aio_await(aio, &w) == 5 && w.buf->pos == 10);
+    KOBJ_DECREF(w.buf);
+
+    struct kos_aio_req r = { .kind = KOS_AIO_READ, .fd = fds[0], .off = -1, .len = 100 };
+    r.buf = kbuffer_new(0, NULL);
+    assert(kos_aio_submit(aio, &r) == KENO_OK);
+    assert(kos_aio_await(aio, &r) == 10 && memcmp(r.buf->data, "helloworld", 10) == 0);
+
+    // end of file, and errors
+    close(fds[1]);
+    assert(kos_aio_submit(aio, &r) == KENO_OK);
+    assert(kos_aio_await(aio, &r) == 0 && r.buf->len == 10);
+    close(fds[0]);
+    r.fd = -1;
+    assert(kos_aio_submit(aio, &r) == KENO_OK);
+    assert(kos_aio_await(aio, &r) == -EBADF);
+    KOBJ_DECREF(r.buf);
+
+    // writes can't go past the end of the buffer
+    w.buf = kbuffer_new(3, (const u8*)"abc");
+    w.buf->pos = 0;
+    assert(kos_aio_submit(aio, &w) != KENO_OK);
+    KOBJ_DECREF(w.buf);
+
+    // or use a buffer which is already in flight
+    r.buf = kbuffer_new(0, NULL);
+    r.fd = fd;
+    r.off = 0;
+    struct kos_aio_req r2 = r;
+    assert(kos_aio_submit(aio, &r) == KENO_OK);
+    assert(kos_aio_submit(aio, &r2) != KENO_OK);
+    assert(kos_aio_await(aio, &r) == 100 && !r.buf->aio);
+    KOBJ_DECREF(r.buf);
+
+    // or use ring buffers
+    r.buf = kbuffer_new(0, NULL);
+    assert(kbuffer_ring(r.buf, 64) == KENO_OK);
+    assert(kos_aio_submit(aio, &r) != KENO_OK);
+    KOBJ_DECREF(r.buf);
+
+    KOBJ_DECREF(aio);
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    // make a file with a known pattern
+    char path[] = "/tmp/kata-test-aio-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    unlink(path);
+    usize i, sz = NREQS * RSZ;
+    u8* data = kmem_make(sz);
+    for (i = 0; i < sz; ++i) data[i] = (u8)(i * 7 + i / 256);
+    assert(write(fd, data, sz) == sz);
+    kmem_free(data);
+
+    my_test(KOS_AIO_AUTO, fd);
+    my_test(KOS_AIO_URING, fd);
+    my_test(KOS_AIO_THREADS, fd);
+
+    close(fd);
+    return 0;
+}
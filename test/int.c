@@ -0,0 +1,90 @@
+/* test/int.c - testing 'kint'
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/test.h>
+
+// check that the repr of an object is 'str'
+static void
+my_check_repr(kobj obj, const char* str) {
+    kbuffer io = kbuffer_new(0, NULL);
+    assert(io != NULL);
+    assert(kprintf(io, "%R", obj) >= 0);
+    assert(io->pos == strlen(str));
+    assert(memcmp(io->data, str, io->pos) == 0);
+    KOBJ_DECREF(io);
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    // values which fit in an 's64' are stored directly
+    kint a = kint_news(INT64_MAX), b = kint_news(1), c = kint_news(-2);
+    assert(KINT_ISSMALL(a) && KINT_ISSMALL(b) && KINT_ISSMALL(c));
+    my_check_repr((kobj)a, "9223372036854775807");
+    my_check_repr((kobj)c, "-2");
+#if KATA_TAGGED
+    assert(KOBJ_ISTAG(c) && KOBJ_TYPE(c) == Kint);
+#endif
+
+    // overflowing is promoted to libbf
+    kint d = (kint)kop_add((kobj)a, (kobj)b);
+    assert(d != NULL && !KINT_ISSMALL(d));
+    my_check_repr((kobj)d, "9223372036854775808");
+
+    kint e = (kint)kop_mul((kobj)a, (kobj)c);
+    assert(e != NULL && !KINT_ISSMALL(e));
+    my_check_repr((kobj)e, "-18446744073709551614");
+
+    // and coming back in range is stored directly again
+    kint f = (kint)kop_fdiv((kobj)e, (kobj)c);
+    assert(f != NULL && KINT_ISSMALL(f));
+    s64 v;
+    assert(kobj_gets((kobj)f, &v) && v == INT64_MAX);
+
+    // floor division rounds towards negative infinity
+    kint g = (kint)kop_fdiv((kobj)kint_news(-7), (kobj)kint_news(2));
+    assert(kobj_gets((kobj)g, &v) && v == -4);
+    kint h = (kint)kop_fdiv((kobj)kint_news(INT64_MIN), (kobj)kint_news(-1));
+    assert(!KINT_ISSMALL(h));
+    my_check_repr((kobj)h, "9223372036854775808");
+
+    // parsing and unsigned values
+    kint i = kint_new("-12345", 10);
+    assert(KINT_ISSMALL(i));
+    assert(kobj_gets((kobj)i, &v) && v == -12345);
+    kint j = kint_newu(UINT64_MAX);
+    assert(!KINT_ISSMALL(j));
+    my_check_repr((kobj)j, "18446744073709551615");
+    kint k = kint_newf(-1e30);
+    assert(!KINT_ISSMALL(k));
+
+    // numbers that are equal hash the same, regardless of type or representation
+    usize ha, hb;
+    bool eq;
+    kfloat fl = kfloat_news(-12345);
+    assert(kobj_hash((kobj)i, &ha) && kobj_hash((kobj)fl, &hb) && ha == hb);
+    assert(kobj_eq((kobj)i, (kobj)fl, &eq) && eq);
+    assert(kobj_eq((kobj)fl, (kobj)i, &eq) && eq);
+    assert(kobj_eq((kobj)i, (kobj)b, &eq) && !eq);
+    kint dd = (kint)kop_add((kobj)d, (kobj)kint_news(0));
+    assert(dd != d && kobj_hash((kobj)d, &ha) && kobj_hash((kobj)dd, &hb) && ha == hb);
+    assert(kobj_eq((kobj)d, (kobj)dd, &eq) && eq);
+    KOBJ_DECREF(fl);
+    KOBJ_DECREF(dd);
+
+    KOBJ_DECREF(a);
+    KOBJ_DECREF(b);
+    KOBJ_DECREF(c);
+    KOBJ_DECREF(d);
+    KOBJ_DECREF(e);
+    KOBJ_DECREF(f);
+    KOBJ_DECREF(g);
+    KOBJ_DECREF(h);
+    KOBJ_DECREF(i);
+    KOBJ_DECREF(j);
+    KOBJ_DECREF(k);
+
+    return 0;
+}
@@ -0,0 +1,379 @@
+/* test/io.c - testing buffered IO ('kio_bufio'), and other IO objects
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/test.h>
+
+#include <unistd.h>
+#include <pthread.h>
+
+// number of threads, and lines each, writing to a shared buffered IO
+#define NTHREADS 4
+#define NLINES 20000
+
+// a user type, whose repr writes (and frees) a temporary string
+KTYPE_DECL(my_Ktmp);
+
+// number of times 'my_tmp_repr' has been called
+static s32 my_ntmp = 0;
+
+// (internal) 'c_repr' slot, which writes 300 copies of a different letter each time
+static ssize
+my_tmp_repr(kobj io, kobj obj) {
+    char data[300];
+    memset(data, 'a' + my_ntmp++ % 26, sizeof(data));
+    kstr t = kstr_new(sizeof(data), data);
+    ssize res = kwriteS(io, (kobj)t);
+    KOBJ_DECREF(t);
+    return res;
+}
+
+// (internal) thread which writes 'NLINES' lines to a shared buffered IO
+static void*
+my_writer(void* arg) {
+    kio_bufio bo = arg;
+    s32 i;
+    for (i = 0; i < NLINES; ++i) {
+        kprintf((kobj)bo, "line %i of %s\n", i, "some thread");
+    }
+    return NULL;
+}
+
+// (internal) thread which copies from a file into a string, which goes through the
+//   per-thread buffer
+static void*
+my_copier(void* arg) {
+    kstr s = kstr_builder(0);
+    assert(kcopy((kobj)arg, (kobj)s, 1000) == 1000);
+    KOBJ_DECREF(s);
+    return NULL;
+}
+
+// (internal) thread which makes, writes to, and closes buffered IO objects
+static void*
+my_closer(void* arg) {
+    s32 i;
+    for (i = 0; i < NLINES / 10; ++i) {
+        kbuffer out = kbuffer_new(0, NULL);
+        kio_bufio bo = kio_bufio_new((kobj)out, 0);
+        assert(kprintf((kobj)bo, "line %i\n", i) > 0);
+        KOBJ_DECREF(bo);
+        assert(out->len > 0);
+        KOBJ_DECREF(out);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+    usize i;
+
+    // writes are kept until the buffer fills up, or it is flushed
+    kbuffer out = kbuffer_new(0, NULL);
+    kio_bufio bo = kio_bufio_new((kobj)out, 16);
+    assert(bo != NULL && !bo->linebuf);
+    assert(kprintf((kobj)bo, "a=%i,", 1) == 4);
+    assert(kwrite((kobj)bo, 6, "bcdefg") == 6);
+    assert(out->len == 0);
+    assert(kwrite((kobj)bo, 8, "hijklmno") == 8);
+    assert(out->len == 10 && memcmp(out->data, "a=1,bcdefg", 10) == 0);
+    assert(kflush((kobj)bo) == 0);
+    assert(out->len == 18 && memcmp(out->data + 10, "hijklmno", 8) == 0);
+
+    // large writes go straight through
+    char big[100];
+    memset(big, 'x', sizeof(big));
+    assert(kwrite((kobj)bo, 1, "y") == 1);
+    assert(kwrite((kobj)bo, sizeof(big), big) == sizeof(big));
+    assert(out->len == 18 + 1 + sizeof(big) && out->data[18] == 'y' && out->data[19] == 'x');
+
+    // line buffering flushes after each newline
+    bo->linebuf = true;
+    assert(kwrite((kobj)bo, 3, "ab\n") == 3);
+    assert(out->len == 18 + 1 + sizeof(big) + 3);
+
+    // pending writes are flushed when the object is deleted
+    bo->linebuf = false;
+    assert(kwrite((kobj)bo, 2, "zz") == 2);
+    usize len = out->len;
+    KOBJ_DECREF(bo);
+    assert(out->len == len + 2);
+
+    // reads are done a buffer at a time, and handed out as requested
+    out->pos = 0;
+    kio_bufio bi = kio_bufio_new((kobj)out, 8);
+    char tmp[200];
+    assert(kread((kobj)bi, 3, tmp) == 3 && memcmp(tmp, "a=1", 3) == 0);
+    assert(out->pos == 8);
+    assert(kread((kobj)bi, 10, tmp) == 5 && memcmp(tmp, ",bcde", 5) == 0);
+    assert(kread((kobj)bi, sizeof(tmp), tmp) == out->len - 8);
+    assert(kread((kobj)bi, sizeof(tmp), tmp) == 0);
+    KOBJ_DECREF(bi);
+    KOBJ_DECREF(out);
+
+    // large reprs borrow string data, and are sent with gather writes, which must give the
+    //   same result as writing to a buffer
+    char piece[1000];
+    for (i = 0; i < sizeof(piece); ++i) piece[i] = 'a' + i % 26;
+    piece[500] = '\n';
+    piece[sizeof(piece) - 1] = '\0';
+    klist l = klist_new(0, NULL);
+    for (i = 0; i < 20; ++i) {
+        kstr s = kstr_new(sizeof(piece) - 1 - i, piece);
+        assert(klist_push(l, (kobj)s));
+        KOBJ_DECREF(s);
+    }
+
+    kbuffer ref = kbuffer_new(0, NULL);
+    assert(kprintf((kobj)ref, "l: %R, %s\n", l, piece + 200) > 0);
+
+    kbuffer got = kbuffer_new(0, NULL);
+    kio_bufio bg = kio_bufio_new((kobj)got, 0);
+    assert(kprintf((kobj)bg, "l: %R, %s\n", l, piece + 200) == ref->len);
+    assert(!bg->borrowed && got->len == ref->len && memcmp(got->data, ref->data, ref->len) == 0);
+    KOBJ_DECREF(bg);
+
+    // nested calls copy instead of borrowing, so the whole repr is sent at once
+    kbuffer nout = kbuffer_new(0, NULL);
+    kio_bufio nbo = kio_bufio_new((kobj)nout, 64 * 1024);
+    kio_hold((kobj)nbo);
+    assert(kprintf((kobj)nbo, "l: %R, %s\n", l, piece + 200) == ref->len);
+    assert(!nbo->borrowed && nbo->nsegs == 1 && nout->len == 0);
+    assert(kio_release((kobj)nbo) == 0 && kflush((kobj)nbo) == 0);
+    assert(nout->len == ref->len && memcmp(nout->data, ref->data, ref->len) == 0);
+    KOBJ_DECREF(nbo);
+    KOBJ_DECREF(nout);
+
+    // data written in a nested call is copied, since it may be freed before the outermost
+    //   call returns
+    ktype_init(my_Ktmp, sizeof(s64), "tmp", "");
+    my_Ktmp->c_repr = my_tmp_repr;
+    kobj tobj = kobj_make(my_Ktmp);
+    kbuffer tout = kbuffer_new(0, NULL);
+    kio_bufio tbo = kio_bufio_new((kobj)tout, 0);
+    assert(kprintf((kobj)tbo, "%R%R%R", tobj, tobj, tobj) == 900);
+    assert(kflush((kobj)tbo) == 0 && tout->len == 900);
+    for (i = 0; i < 900; ++i) assert(tout->data[i] == 'a' + i / 300);
+    KOBJ_DECREF(tbo);
+    KOBJ_DECREF(tout);
+    KOBJ_DECREF(tobj);
+
+    int fds[2];
+    assert(pipe(fds) == 0);
+    kos_rawio w = kos_rawio_newd(fds[1]);
+    kio_bufio bw = kio_bufio_new((kobj)w, 0);
+    assert(kprintf((kobj)bw, "l: %R, %s\n", l, piece + 200) == ref->len);
+    assert(!bw->borrowed && bw->nsegs == 0);
+    KOBJ_DECREF(bw);
+    KOBJ_DECREF(w);
+
+    usize n = 0;
+    u8* rd = kmem_make(ref->len + 1);
+    while (n < ref->len) {
+        ssize sz = read(fds[0], rd + n, ref->len + 1 - n);
+        assert(sz > 0);
+        n += sz;
+    }
+    assert(n == ref->len && memcmp(rd, ref->data, n) == 0);
+    kmem_free(rd);
+    close(fds[0]);
+    close(fds[1]);
+
+    KOBJ_DECREF(got);
+    KOBJ_DECREF(ref);
+    KOBJ_DECREF(l);
+
+    // memory maps can be read like buffers, and are NUL-terminated even when the file ends at
+    //   a page boundary
+    char path[] = "/tmp/kata-test-io-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    usize pg = sysconf(_SC_PAGESIZE);
+    u8* fdata = kmem_make(pg);
+    for (i = 0; i < pg; ++i) fdata[i] = 'a' + i % 26;
+    assert(write(fd, fdata, pg) == pg);
+    close(fd);
+
+    kos_mmap m = kos_mmap_new(path, KOS_MMAP_SEQ);
+    unlink(path);
+    assert(m != NULL && m->len == pg && m->data[pg] == '\0');
+    assert(memcmp(m->data, fdata, pg) == 0);
+    assert(kread((kobj)m, 10, tmp) == 10 && memcmp(tmp, fdata, 10) == 0);
+    assert(kread((kobj)m, pg, rd = kmem_make(pg)) == pg - 10 && memcmp(rd, fdata + 10, pg - 10) == 0);
+    assert(kread((kobj)m, 10, tmp) == 0);
+    kmem_free(rd);
+
+    // strings can be views of it, which keep it alive, until they are changed
+    kstr ms = kstr_view((kobj)m, m->len, m->data);
+    assert(ms != NULL && ms->data == m->data && ms->lenc == pg);
+    KOBJ_DECREF(m);
+    assert(ms->data[0] == 'a');
+    kstr ms2 = (kstr)kop_addz((kobj)ms, (kobj)ms);
+    ms2 = (kstr)kop_addz((kobj)ms2, (kobj)kstr_intern(-1, "z"));
+    assert(ms2->lenb == 2 * pg + 1 && ms2->src == NULL && memcmp(ms2->data + pg, fdata, pg) == 0);
+    KOBJ_DECREF(ms2);
+    kmem_free(fdata);
+
+    assert(kos_mmap_new("/nonexistent/file", 0) == NULL);
+
+    // rings wrap around, and only take what fits
+    kbuffer rb = kbuffer_new(3, (const u8*)"xyz");
+    assert(kread((kobj)rb, 1, tmp) == 1 && tmp[0] == 'x');
+    assert(kbuffer_ring(rb, 8) == 0 && rb->ring && rb->len == 2 && rb->pos == 0);
+    u8* rdata = rb->data;
+    assert(kwrite((kobj)rb, 4, "abcd") == 4);
+    assert(kread((kobj)rb, 5, tmp) == 5 && memcmp(tmp, "yzabc", 5) == 0);
+    assert(kwrite((kobj)rb, 10, "0123456789") == 7);
+    assert(kbuffer_push(rb, 1, (const u8*)"!") < 0);
+    kstr rs = kbuffer_str(rb);
+    assert(rs->lenb == 8 && memcmp(rs->data, "d0123456", 8) == 0);
+    KOBJ_DECREF(rs);
+    usize rn;
+    const u8* rp = kbuffer_peek(rb, &rn);
+    assert(rn == 3 && memcmp(rp, "d01", 3) == 0);
+    kbuffer_consume(rb, 3);
+    rp = kbuffer_peek(rb, &rn);
+    assert(rn == 5 && memcmp(rp, "23456", 5) == 0);
+    assert(kread((kobj)rb, sizeof(tmp), tmp) == 5);
+    assert(kread((kobj)rb, sizeof(tmp), tmp) == 0 && rb->len == 0);
+
+    // a ring between an fd and a consumer, which stays in bounded memory
+    assert(pipe(fds) == 0);
+    usize total = 100000, got_n = 0, put_n = 0;
+    while (got_n < total) {
+        // produce some, as much as the pipe takes
+        while (put_n < total && put_n - got_n < 3000) {
+            u8 chunk[777];
+            usize k, m = total - put_n < sizeof(chunk) ? total - put_n : sizeof(chunk);
+            for (k = 0; k < m; ++k) chunk[k] = (u8)((put_n + k) % 251);
+            ssize sz = write(fds[1], chunk, m);
+            assert(sz > 0);
+            put_n += sz;
+        }
+
+        // read directly into the ring's free space, and consume from it
+        rn = 1;
+        u8* wp = kbuffer_reserve(rb, &rn);
+        if (rn > 0) {
+            ssize sz = read(fds[0], wp, rn);
+            assert(sz > 0);
+            kbuffer_commit(rb, sz);
+        }
+        rp = kbuffer_peek(rb, &rn);
+        for (i = 0; i < rn; ++i) assert(rp[i] == (u8)((got_n + i) % 251));
+        kbuffer_consume(rb, rn);
+        got_n += rn;
+    }
+    assert(rb->data == rdata && rb->cap == 8);
+    close(fds[0]);
+    close(fds[1]);
+    KOBJ_DECREF(rb);
+
+    // copies between files, and to pipes, are done by the kernel
+    usize cn = 300000;
+    u8* cdata = kmem_make(cn);
+    for (i = 0; i < cn; ++i) cdata[i] = i % 253;
+    char cpath0[] = "/tmp/kata-test-io-XXXXXX", cpath1[] = "/tmp/kata-test-io-XXXXXX";
+    int cfd0 = mkstemp(cpath0), cfd1 = mkstemp(cpath1);
+    assert(cfd0 >= 0 && cfd1 >= 0);
+    unlink(cpath0);
+    unlink(cpath1);
+    assert(write(cfd0, cdata, cn) == cn);
+    assert(lseek(cfd0, 0, SEEK_SET) == 0);
+
+    kos_rawio cf0 = kos_rawio_newd(cfd0), cf1 = kos_rawio_newd(cfd1);
+    assert(kcopy((kobj)cf0, (kobj)cf1, -1) == cn);
+    assert(kcopy((kobj)cf0, (kobj)cf1, -1) == 0);
+    u8* cback = kmem_make(cn);
+    assert(pread(cfd1, cback, cn, 0) == cn && memcmp(cback, cdata, cn) == 0);
+
+    assert(pipe(fds) == 0);
+    kos_rawio cpw = kos_rawio_newd(fds[1]), cpr = kos_rawio_newd(fds[0]);
+    assert(lseek(cfd0, 1000, SEEK_SET) == 1000);
+    assert(kcopy((kobj)cf0, (kobj)cpw, 5000) == 5000);
+    assert(read(fds[0], cback, cn) == 5000 && memcmp(cback, cdata + 1000, 5000) == 0);
+
+    // and from pipes, into files or memory
+    assert(write(fds[1], cdata, 3000) == 3000);
+    assert(lseek(cfd1, 0, SEEK_SET) == 0);
+    assert(kcopy((kobj)cpr, (kobj)cf1, 3000) == 3000);
+    assert(pread(cfd1, cback, 3000, 0) == 3000 && memcmp(cback, cdata, 3000) == 0);
+    assert(write(fds[1], cdata, 3000) == 3000);
+    kbuffer cb = kbuffer_new(0, NULL);
+    assert(kcopy((kobj)cpr, (kobj)cb, 3000) == 3000);
+    assert(cb->len == 3000 && memcmp(cb->data, cdata, 3000) == 0);
+
+    // memory is written straight from, and buffered IO gives what it already read first
+    kio_bufio cbr = kio_bufio_new((kobj)cpr, 0);
+    assert(write(fds[1], cdata, 100) == 100);
+    assert(kread((kobj)cbr, 10, tmp) == 10 && cbr->rlen == 100);
+    assert(kwrite((kobj)cpw, 50, cdata + 100) == 50);
+    kstr cs = kstr_builder(0);
+    assert(kcopy((kobj)cbr, (kobj)cs, 140) == 140);
+    assert(cs->lenb == 140 && memcmp(cs->data, cdata + 10, 140) == 0);
+    KOBJ_DECREF(cs);
+    KOBJ_DECREF(cbr);
+
+    // the per-thread buffer is freed when the thread exits
+#if KATA_MEM_STATS
+    struct kmem_stats cst0, cst1;
+    assert(lseek(cfd0, 0, SEEK_SET) == 0);
+    kmem_stats(&cst0);
+    pthread_t cth;
+    assert(pthread_create(&cth, NULL, my_copier, cf0) == 0);
+    assert(pthread_join(cth, NULL) == 0);
+    kmem_stats(&cst1);
+    assert(cst1.bmake - cst0.bmake >= 256 * 1024 && cst1.bmake - cst0.bmake == cst1.bfree - cst0.bfree);
+#endif
+
+    kbuffer co = kbuffer_new(0, NULL);
+    kio_bufio cbo = kio_bufio_new((kobj)co, 0);
+    assert(kwrite((kobj)cbo, 2, "<<") == 2);
+    assert(kcopy((kobj)cb, (kobj)cbo, -1) == 3000 && cb->pos == cb->len);
+    assert(co->len == 3002 && memcmp(co->data + 2, cdata, 3000) == 0);
+    KOBJ_DECREF(cbo);
+    KOBJ_DECREF(co);
+    KOBJ_DECREF(cb);
+
+    close(fds[0]);
+    close(fds[1]);
+    close(cfd0);
+    close(cfd1);
+    KOBJ_DECREF(cpw);
+    KOBJ_DECREF(cpr);
+    KOBJ_DECREF(cf0);
+    KOBJ_DECREF(cf1);
+    kmem_free(cback);
+    kmem_free(cdata);
+
+    // buffered IO can be shared between threads, and each 'kprintf' stays together
+    kbuffer mt = kbuffer_new(0, NULL);
+    kio_bufio mtb = kio_bufio_new((kobj)mt, 64);
+    pthread_t ths[NTHREADS];
+    for (i = 0; i < NTHREADS; ++i) assert(pthread_create(&ths[i], NULL, my_writer, mtb) == 0);
+    for (i = 0; i < NTHREADS; ++i) assert(pthread_join(ths[i], NULL) == 0);
+    assert(kflush((kobj)mtb) == 0);
+    usize nl = 0, ln = 0;
+    for (i = 0; i < mt->len; i = ln + 1) {
+        ln = (u8*)memchr(mt->data + i, '\n', mt->len - i) - mt->data;
+        assert(ln - i > 20 && memcmp(mt->data + i, "line ", 5) == 0 && memcmp(mt->data + ln - 11, "some thread", 11) == 0);
+        nl++;
+    }
+    assert(nl == NTHREADS * NLINES);
+    KOBJ_DECREF(mtb);
+    KOBJ_DECREF(mt);
+
+    // flushing everything may race with other threads closing theirs
+    for (i = 0; i < NTHREADS; ++i) assert(pthread_create(&ths[i], NULL, my_closer, NULL) == 0);
+    for (i = 0; i < 1000; ++i) kio_flushall();
+    for (i = 0; i < NTHREADS; ++i) assert(pthread_join(ths[i], NULL) == 0);
+
+    // the standard streams are buffered
+    assert(KOBJ_TYPE(Kos_stdout) == Kio_bufio && KOBJ_TYPE(Kos_stderr) == Kio_bufio);
+    assert(Kos_stderr->linebuf);
+    assert(kprintf((kobj)Kos_stdout, "hello, %s\n", "world") >= 0);
+    assert(kflush((kobj)Kos_stdout) == 0);
+
+    return 0;
+}
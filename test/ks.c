@@ -7,6 +7,8 @@
 #include <kata/ks.h>
 #include <kata/vm.h>
 
+#include <unistd.h>
+
 int main(int argc, char** argv) {
     kinit(true);
 
@@ -36,7 +38,6 @@ int main(int argc, char** argv) {
     KOBJ_DECREF(prog);
     
     KOBJ_DECREF(src);
-    KOBJ_DECREF(filename); 
 
     usize i;
     for (i = 0; i < ntoks; ++i) {
@@ -44,6 +45,62 @@ int main(int argc, char** argv) {
     }
     kmem_free(toks);
 
+    // now, parse again with tokens and AST nodes allocated from an arena
+    struct kmem_arena arena;
+    kmem_arena_init(&arena);
+
+    src = kstr_new(-1, "1 + 2 * 3 + 4");
+    ntoks = 0;
+    toks = NULL;
+    prog = ks_parsea(filename, src, &ntoks, &toks, &arena);
+    assert(prog != NULL);
+    assert(kmem_pmap_get(KOBJ_META(prog)) == KMEM_CHUNK_ARENA);
+    assert(kmem_pmap_get(KOBJ_META(toks[0])) == KMEM_CHUNK_ARENA);
+    assert(kprintf(Kos_stdout, "ks.parse(filename, src):\n%R\n", prog) >= 0);
+
+    res = kvm_eval(NULL, NULL, prog);
+    assert(res != NULL);
+    assert(kprintf(Kos_stdout, "kvm.eval(prog): %R\n", res) >= 0);
+    KOBJ_DECREF(res);
+
+    // releases the constants, but tokens are just dropped with the arena
+    KOBJ_DECREF(prog);
+    kmem_free(toks);
+    kmem_arena_done(&arena);
+
+    KOBJ_DECREF(src);
+
+    // parse straight from a memory mapped file, without copying the source
+    char path[] = "/tmp/kata-test-ks-XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd >= 0);
+    assert(write(fd, "2 * 3 + 4 * 5", 13) == 13);
+    close(fd);
+
+    kos_mmap m = kos_mmap_new(path, KOS_MMAP_SEQ | KOS_MMAP_WILLNEED);
+    assert(m != NULL && m->len == 13);
+    unlink(path);
+    src = kstr_view((kobj)m, m->len, m->data);
+    assert(src != NULL && src->data == m->data && src->lenc == 13);
+    KOBJ_DECREF(m);
+
+    ntoks = 0;
+    toks = NULL;
+    prog = ks_parse(filename, src, &ntoks, &toks);
+    assert(prog != NULL);
+    res = kvm_eval(NULL, NULL, prog);
+    s64 v;
+    assert(res != NULL && kobj_gets(res, &v) && v == 26);
+    KOBJ_DECREF(res);
+    KOBJ_DECREF(prog);
+    for (i = 0; i < ntoks; ++i) {
+        KOBJ_DECREF(toks[i]);
+    }
+    kmem_free(toks);
+
+    KOBJ_DECREF(src);
+    KOBJ_DECREF(filename);
+
     return 0;
 }
 
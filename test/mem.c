@@ -0,0 +1,272 @@
+/* test/mem.c - testing 'kmem'
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/test.h>
+
+#include <pthread.h>
+
+// number of blocks allocated by 'my_thread'
+#define NTHD 1000
+
+// allocate blocks in a different thread, which then exits
+static void*
+my_thread(void* arg) {
+    void** blks = arg;
+    usize i;
+    for (i = 0; i < NTHD; ++i) {
+        blks[i] = kmem_make(32);
+        assert(blks[i] != NULL);
+    }
+    return NULL;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    // allocate one block of every small size, and fill them with a pattern
+    u8* blks[KMEM_SLAB_MAX + 1];
+    usize i, j;
+    for (i = 1; i <= KMEM_SLAB_MAX; ++i) {
+        blks[i] = kmem_make(i);
+        assert(blks[i] != NULL);
+        assert(kmem_slab_has(blks[i]));
+        assert(kmem_slab_sizeof(blks[i]) >= i);
+        assert(((uintptr_t)blks[i]) % 16 == 0);
+        memset(blks[i], (int)(i & 0xFF), i);
+    }
+
+    // make sure no blocks overlap
+    for (i = 1; i <= KMEM_SLAB_MAX; ++i) {
+        for (j = 0; j < i; ++j) {
+            assert(blks[i][j] == (u8)(i & 0xFF));
+        }
+    }
+
+    // grow a slab block across size classes, and then out of the slab range
+    u8* g = kmem_make(10);
+    assert(g != NULL);
+    for (i = 0; i < 10; ++i) g[i] = (u8)i;
+    assert(kmem_grow((void**)&g, 100));
+    assert(kmem_grow((void**)&g, 4 * KMEM_SLAB_MAX));
+    assert(!kmem_slab_has(g));
+    for (i = 0; i < 10; ++i) assert(g[i] == (u8)i);
+    kmem_free(g);
+
+    // freed blocks should be reused
+    for (i = 1; i <= KMEM_SLAB_MAX; ++i) {
+        kmem_free(blks[i]);
+    }
+    void* p = kmem_make(KMEM_SLAB_MAX);
+    assert(p == blks[KMEM_SLAB_MAX]);
+    kmem_free(p);
+
+    // free blocks allocated by another thread, and make sure they are given back
+    //   to that thread's heap (which is adopted by the next thread)
+    static void* tblks[NTHD], *tblks2[NTHD];
+    pthread_t thd;
+    assert(pthread_create(&thd, NULL, my_thread, tblks) == 0);
+    assert(pthread_join(thd, NULL) == 0);
+    for (i = 0; i < NTHD; ++i) kmem_free(tblks[i]);
+    kmem_flush();
+
+    assert(pthread_create(&thd, NULL, my_thread, tblks2) == 0);
+    assert(pthread_join(thd, NULL) == 0);
+    usize nreuse = 0;
+    for (i = 0; i < NTHD; ++i) {
+        for (j = 0; j < NTHD; ++j) {
+            if (tblks2[i] == tblks[j]) {
+                nreuse++;
+                break;
+            }
+        }
+    }
+    assert(nreuse == NTHD);
+    for (i = 0; i < NTHD; ++i) kmem_free(tblks2[i]);
+    kmem_flush();
+
+    // arenas, with marks
+    struct kmem_arena arena;
+    kmem_arena_init(&arena);
+    u8* a0 = kmem_arena_make(&arena, 100);
+    assert(a0 != NULL);
+    assert(kmem_pmap_get(a0) == KMEM_CHUNK_ARENA);
+    memset(a0, 0xAB, 100);
+    struct kmem_arena_mark mark = kmem_arena_mark(&arena);
+
+    // make enough to need several chunks, and one that is larger than a chunk
+    for (i = 0; i < 1000; ++i) {
+        u8* a = kmem_arena_make(&arena, 1000);
+        assert(a != NULL);
+        assert(((uintptr_t)a) % 16 == 0);
+        memset(a, 0xCD, 1000);
+    }
+    u8* abig = kmem_arena_make(&arena, 4 * KMEM_SLAB_SZ);
+    assert(abig != NULL);
+    memset(abig, 0xEF, 4 * KMEM_SLAB_SZ);
+    assert(kmem_pmap_get(abig + 3 * KMEM_SLAB_SZ) == KMEM_CHUNK_ARENA);
+
+    // freeing arena blocks does nothing
+    kmem_free(abig);
+
+    // reset back to the mark, which should reuse the same memory
+    kmem_arena_reset(&arena, mark);
+    u8* a1 = kmem_arena_make(&arena, 16);
+    assert(a1 == a0 + 112);
+    for (i = 0; i < 100; ++i) assert(a0[i] == 0xAB);
+
+    // objects from an arena
+    kint y = kobj_makea(&arena, Kint, sizeof(struct kint));
+    assert(y != NULL);
+    assert(KOBJ_TYPE(y) == Kint);
+    assert(KOBJ_REFC(y) == 1);
+    kobj_del(y);
+
+    kmem_arena_done(&arena);
+    assert(arena.chunk == NULL);
+
+    // objects should come from slabs as well
+    kint x = kint_newu(UINT64_MAX);
+    assert(x != NULL);
+    assert(kmem_slab_has(KOBJ_META(x)));
+    KOBJ_DECREF(x);
+
+    // sizes of blocks
+    void* s0 = kmem_make(20);
+    assert(kmem_sizeof(s0) == 32);
+    void* s1 = kmem_make(3 * KMEM_SLAB_MAX);
+    assert(kmem_sizeof(s1) == 3 * KMEM_SLAB_MAX);
+    assert(kmem_grow(&s1, 5 * KMEM_SLAB_MAX));
+    assert(kmem_sizeof(s1) == 5 * KMEM_SLAB_MAX);
+    assert(((uintptr_t)s1) % 16 == 0);
+
+#if KATA_MEM_STATS
+    // statistics, which should notice the blocks above
+    struct kmem_stats st0, st1;
+    kmem_stats(&st0);
+    assert(st0.nmake >= st0.nfree);
+    assert(st0.bmake - st0.bfree == st0.cur);
+    assert(st0.peak >= st0.cur);
+    assert(st0.cur >= 32 + 5 * KMEM_SLAB_MAX);
+
+    kmem_free(s0);
+    kmem_free(s1);
+    kmem_stats(&st1);
+    assert(st1.nfree == st0.nfree + 2);
+    assert(st1.cur == st0.cur - 32 - 5 * KMEM_SLAB_MAX);
+
+    // live objects per type
+    usize nlive, nlive_sz, live, live_sz;
+    kmem_stats_type(Kint, &nlive, &nlive_sz);
+    kint z = kint_newu(UINT64_MAX);
+    kmem_stats_type(Kint, &live, &live_sz);
+    assert(live == nlive + 1);
+    assert(live_sz == nlive_sz + kmem_sizeof(KOBJ_META(z)));
+    KOBJ_DECREF(z);
+    kmem_stats_type(Kint, &live, &live_sz);
+    assert(live == nlive);
+    assert(live_sz == nlive_sz);
+
+    kdict d = kmem_stats_dict();
+    assert(d != NULL);
+    KOBJ_DECREF(d);
+#else
+    kmem_free(s0);
+    kmem_free(s1);
+#endif
+
+    // huge blocks, which are mapped from the OS and can grow in place
+    u8* h0 = kmem_make(KMEM_HUGE_MIN);
+    assert(h0 != NULL);
+    assert(((uintptr_t)h0) % 16 == 0);
+    assert(kmem_sizeof(h0) == KMEM_HUGE_MIN);
+    for (i = 0; i < KMEM_HUGE_MIN; i += 4096) h0[i] = i >> 12;
+    assert(kmem_grow((void**)&h0, 8 * KMEM_HUGE_MIN));
+    assert(kmem_sizeof(h0) == 8 * KMEM_HUGE_MIN);
+    for (i = 0; i < KMEM_HUGE_MIN; i += 4096) assert(h0[i] == (u8)(i >> 12));
+    h0[8 * KMEM_HUGE_MIN - 1] = 42;
+    kmem_free(h0);
+
+    // a C library block becoming a huge block
+    u8* h1 = kmem_make(4 * KMEM_SLAB_MAX);
+    memset(h1, 7, 4 * KMEM_SLAB_MAX);
+    assert(kmem_grow((void**)&h1, 2 * KMEM_HUGE_MIN));
+    for (i = 0; i < 4 * KMEM_SLAB_MAX; ++i) assert(h1[i] == 7);
+    kmem_free(h1);
+
+    // immortal objects, which reference counting skips
+    assert(KOBJ_ISIMMORTAL(Kint));
+    assert(KOBJ_ISIMMORTAL(Kint->name));
+    assert(KOBJ_ISIMMORTAL(Kexc));
+    assert(KOBJ_ISIMMORTAL(Kglobals));
+    assert(KOBJ_ISIMMORTAL(Ksc_del));
+    assert(KOBJ_ISIMMORTAL(Kos_stdout));
+    usize refc = KOBJ_REFC(Kstr);
+    KOBJ_INCREF(Kstr);
+    KOBJ_DECREF(Kstr);
+    KOBJ_DECREF(Kstr);
+    assert(KOBJ_REFC(Kstr) == refc);
+
+    kint im = kint_newu(UINT64_MAX);
+    assert(!KOBJ_ISIMMORTAL(im));
+    kobj_immortal((kobj)im);
+    KOBJ_DECREF(im);
+    KOBJ_DECREF(im);
+    assert(KOBJ_ISIMMORTAL(im));
+
+    // small integers are cached, so making them doesn't allocate
+#if KATA_INT_CACHE_MIN <= KATA_INT_CACHE_MAX
+    kint c0 = kint_news(KATA_INT_CACHE_MIN), c1 = kint_news(KATA_INT_CACHE_MAX);
+    assert(c0 == kint_news(KATA_INT_CACHE_MIN));
+    assert(c1 == kint_news(KATA_INT_CACHE_MAX));
+    assert(KOBJ_ISIMMORTAL(c0) && KOBJ_ISIMMORTAL(c1));
+#endif
+#if !KATA_TAGGED
+    assert(kint_news(KATA_INT_CACHE_MAX + 1) != kint_news(KATA_INT_CACHE_MAX + 1));
+#endif
+#if KATA_INT_CACHE_MIN <= -4 && KATA_INT_CACHE_MAX >= 999
+    assert(kint_newf(3.5) == kint_news(3));
+    assert(kint_newf(-3.5) == kint_news(-4));
+    kobj c2 = kop_add((kobj)kint_news(40), (kobj)kint_news(2));
+    assert(c2 == (kobj)kint_news(42));
+  #if KATA_MEM_STATS
+    kmem_stats(&st0);
+    for (i = 0; i < 1000; ++i) {
+        KOBJ_DECREF(kint_news(i));
+        KOBJ_DECREF(krrv(i));
+    }
+    kmem_stats(&st1);
+    assert(st1.nmake == st0.nmake);
+  #endif
+#endif
+
+    // hashing, where streaming and fused versions must match the one-shot hash
+    u8 hdata[300];
+    for (i = 0; i < sizeof(hdata); ++i) hdata[i] = 1 + (i * 2654435761u) % 251;
+    for (i = 0; i < 200; ++i) {
+        usize h = kmem_hash(i, hdata);
+        assert(h != kmem_hash(i + 1, hdata));
+
+        struct kmem_hasher hs;
+        kmem_hasher_init(&hs);
+        usize k = 0, step = 1 + i % 7;
+        while (k < i) {
+            usize n = i - k < step ? i - k : step;
+            kmem_hasher_update(&hs, n, hdata + k);
+            k += n;
+            step = step * 3 % 41 + 1;
+        }
+        assert(kmem_hasher_final(&hs) == h);
+
+        // at various alignments
+        char hstr[256];
+        usize off = i % 8, hlen;
+        memcpy(hstr + off, hdata, i);
+        hstr[off + i] = '\0';
+        assert(kmem_hashz(hstr + off, &hlen) == kmem_hash(i, (u8*)hstr + off));
+        assert(hlen == i);
+    }
+
+    return 0;
+}
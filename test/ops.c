@@ -0,0 +1,82 @@
+/* test/ops.c - testing 'kop_*' dispatch
+ *
+ * @author: Cade Brown <me@cade.site>
+ */
+
+#include <kata/test.h>
+
+// a user type, which only defines '__add' as an attribute
+KTYPE_DECL(my_Kvec);
+
+struct my_vec {
+    s64 x;
+};
+
+// vec.__add(a, b), which returns 'a.x + b'
+static KCFUNC(my_vec_add_) {
+    kobj a, b;
+    KARGS("a b", &a, &b);
+    kobj x = (kobj)kint_news(((struct my_vec*)a)->x);
+    kobj res = kop_add(x, b);
+    KOBJ_DECREF(x);
+    return res;
+}
+
+// vec * int kernel, which returns 'a.x * b'
+static kobj
+my_vec_mul(kobj a, kobj b) {
+    kobj x = (kobj)kint_news(((struct my_vec*)a)->x);
+    kobj res = kop_mul(x, b);
+    KOBJ_DECREF(x);
+    return res;
+}
+
+int main(int argc, char** argv) {
+    kinit(true);
+
+    // registered kernels for each pair of builtins
+    kobj i = (kobj)kint_news(3), f = (kobj)kfloat_news(2);
+    kobj r = kop_add(i, f);
+    assert(r != NULL && KOBJ_TYPE(r) == Kfloat);
+    KOBJ_DECREF(r);
+    r = kop_add(f, f);
+    assert(r != NULL && KOBJ_TYPE(r) == Kfloat);
+    KOBJ_DECREF(r);
+    r = kop_mul(i, i);
+    s64 v;
+    assert(r != NULL && kobj_gets(r, &v) && v == 9);
+    KOBJ_DECREF(r);
+
+    kstr s = kstr_new(-1, "ab");
+    r = kop_add((kobj)s, (kobj)s);
+    assert(r != NULL && KOBJ_TYPE(r) == Kstr && strcmp(((kstr)r)->data, "abab") == 0);
+    KOBJ_DECREF(r);
+
+    // unsupported pairs are an error, not an abort
+    assert(kop_add(i, (kobj)s) == NULL);
+    assert(kop_pow((kobj)s, (kobj)s) == NULL);
+
+    // user types fall back to their attributes
+    ktype_init(my_Kvec, sizeof(struct my_vec), "vec", "");
+    ktype_merge(my_Kvec, KDICT_IKV(
+        { "__add", kfunc_new(my_vec_add_, "vec.__add(a, b)", "") },
+    ));
+    struct my_vec* vec = kobj_make(my_Kvec);
+    vec->x = 10;
+    r = kop_add((kobj)vec, i);
+    assert(r != NULL && kobj_gets(r, &v) && v == 13);
+    KOBJ_DECREF(r);
+
+    // and can register kernels
+    assert(kop_mul((kobj)vec, i) == NULL);
+    assert(kop_register(KOP_MUL, my_Kvec, Kint, my_vec_mul));
+    r = kop_mul((kobj)vec, i);
+    assert(r != NULL && kobj_gets(r, &v) && v == 30);
+    KOBJ_DECREF(r);
+
+    KOBJ_DECREF(vec);
+    KOBJ_DECREF(s);
+    KOBJ_DECREF(i);
+    KOBJ_DECREF(f);
+    return 0;
+}
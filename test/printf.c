@@ -5,6 +5,13 @@
 
 #include <kata/test.h>
 
+// check that 's' is 'exp', and delete it
+static void
+my_check(kstr s, const char* exp) {
+    assert(s != NULL && s->lenb == strlen(exp) && memcmp(s->data, exp, s->lenb) == 0);
+    KOBJ_DECREF(s);
+}
+
 int main(int argc, char** argv) {
     kinit(true);
 
@@ -12,6 +19,84 @@ int main(int argc, char** argv) {
     assert(kprintf(Kos_stdout, "constants:\n  tau=%f\n  pi=%f\n  e=%f\n  ln(2)=%f\n  ln(10)=%f\n", F64_TAU, F64_PI, F64_E, F64_LN2, F64_LN10) >= 0);
     assert(kprintf(Kos_stdout, "special values:\n  inf=%f\n  -inf=%f\n  nan=%f\n  -0.0=%f\n", F64_INF, -F64_INF, F64_NAN, -0.0) >= 0);
 
+    // integers, with widths and flags
+    my_check(kstr_fmt("%i|%5i|%-5i|%05i|%+i|% i|%+05i", 42, 42, 42, -42, 42, 42, 7), "42|   42|42   |-0042|+42| 42|+0007");
+    my_check(kstr_fmt("%*i|%*i|%-05i|%2i", 6, 7, -3, 7, 9, 12345), "     7|7  |9    |12345");
+    my_check(kstr_fmt("%u %v %v", (u64)-1, (s64)INT64_MIN, (s64)INT64_MAX), "18446744073709551615 -9223372036854775808 9223372036854775807");
+    my_check(kstr_fmt("%+u|% u|%+5u|% 05u", (u64)781, (u64)781, (u64)781, (u64)781), "781|781|  781|00781");
+    my_check(kstr_fmt("%-+5i|%- 5i|%-05i|%+ i|%0-5i|%++i", 42, 42, -42, 42, 7, 3), "+42  | 42  |-42  |+42|7    |+3");
+    my_check(kstr_fmt("%.5i|%8.5i|%-8.3u|%.0i|%+.3v|%08.3i|%5.0i|", 42, -42, (u64)7, 0, (s64)5, 5, 0), "00042|  -00042|007     ||+005|     005|     |");
+    my_check(kstr_fmt("%.*i|%.20u", 3, -7, (u64)-1), "-007|18446744073709551615");
+
+    // every length of decimal, around each power of 10
+    char tmp[800];
+    u64 p10 = 1;
+    int i;
+    for (i = 0; i < 20; ++i, p10 *= 10) {
+        snprintf(tmp, sizeof(tmp), "%llu %llu %lld", (unsigned long long)p10, (unsigned long long)(p10 - 1), -(long long)(p10 - 1));
+        my_check(kstr_fmt("%u %u %v", p10, p10 - 1, -(s64)(p10 - 1)), tmp);
+    }
+
+    // floats are the shortest that read back the same, unless given a precision
+    my_check(kstr_fmt("%f %f %f %f %f %f", 0.1, 100.0, 1e15, 1e16, 1e-4, 1e-5), "0.1 100.0 1000000000000000.0 1e+16 0.0001 1e-05");
+    my_check(kstr_fmt("%f %f %f %f", 5e-324, 1.7976931348623157e308, -0.0, 0.30000000000000004), "5e-324 1.7976931348623157e+308 -0.0 0.30000000000000004");
+    my_check(kstr_fmt("%.2f %.0f %.0f %.3f %.1f", 2.675, 0.5, 1.5, 1e-10, 1e20), "2.67 0 2 0.000 100000000000000000000.0");
+    my_check(kstr_fmt("%08.3f|%-7f|%+f|% f|%6f|%06f", -3.14159, 2.5, 1.0, 1.0, F64_INF, -F64_INF), "-003.142|2.5    |+1.0| 1.0|   inf|  -inf");
+
+    // every float must read back the same, and match C to any precision
+    u64 fb = 0x2545F4914F6CDD1DULL;
+    for (i = 0; i < 20000; ++i) {
+        fb ^= fb << 13;
+        fb ^= fb >> 7;
+        fb ^= fb << 17;
+        f64 fv;
+        u64 fvb = fb & ~(1ULL << 63);
+        memcpy(&fv, &fvb, sizeof(fv));
+        if (fv != fv || fv == F64_INF) continue;
+
+        kstr fs = kstr_fmt("%f", fv);
+        assert(fs != NULL && strtod(fs->data, NULL) == fv);
+        KOBJ_DECREF(fs);
+
+        // values in a range where C doesn't need too many digits
+        fv = (f64)(fb >> 11) / (1ULL << (fb % 53));
+        s32 fp = fb % 25;
+        snprintf(tmp, sizeof(tmp), "%.*f", fp, fv);
+        my_check(kstr_fmt("%.*f", fp, fv), tmp);
+    }
+
+    // long fields through buffered IO, which must not borrow temporary digits
+    kbuffer bout = kbuffer_new(0, NULL);
+    kio_bufio bo = kio_bufio_new((kobj)bout, 0);
+    assert(kprintf((kobj)bo, "%.0f|%-300f|", 1e300, 0.5) >= 0);
+    assert(kflush((kobj)bo) == 0);
+    int blen = snprintf(tmp, sizeof(tmp), "%.0f|%-300s|", 1e300, "0.5");
+    assert(bout->len == blen && memcmp(bout->data, tmp, blen) == 0);
+    KOBJ_DECREF(bo);
+    KOBJ_DECREF(bout);
+
+    // other bases
+    kstr ks = kstr_builder(0);
+    assert(kwriteu((kobj)ks, 255, 16, 0, 0) == 2 && kwrite((kobj)ks, 1, " ") == 1);
+    assert(kwriteu((kobj)ks, 5, 2, 8, KWRITE_ZERO) == 8 && kwrite((kobj)ks, 1, " ") == 1);
+    assert(kwriteu((kobj)ks, 64, 8, 0, 0) == 3 && kwrite((kobj)ks, 1, " ") == 1);
+    assert(kwrites((kobj)ks, -10, 3, 0, 0) == 4 && kwrite((kobj)ks, 1, " ") == 1);
+    assert(kwriteu((kobj)ks, (u64)-1, 16, 0, 0) == 16);
+    my_check(kstr_seal(ks), "FF 00000101 100 -101 FFFFFFFFFFFFFFFF");
+
+    // fields wider than the internal buffer
+    memset(tmp, ' ', 297);
+    strcpy(tmp + 297, "-12");
+    my_check(kstr_fmt("%300i", -12), tmp);
+    memset(tmp, '0', 300);
+    tmp[0] = '-';
+    tmp[298] = '1';
+    tmp[299] = '2';
+    my_check(kstr_fmt("%0300i", -12), tmp);
+    memset(tmp, ' ', 300);
+    memcpy(tmp, "12", 2);
+    my_check(kstr_fmt("%-300i", 12), tmp);
+
 
     kstr xyz = kstr_new(3, "xyz");
     assert(xyz != NULL);
@@ -5,16 +5,227 @@
 
 #include <kata/test.h>
 
+#include <pthread.h>
+
+#define NTHREADS 4
+
+// reference UTF-8 validator, which decodes codepoints directly
+static bool
+my_ref_utf8(usize lenb, const u8* data, usize* lenc) {
+    usize i = 0, n = 0;
+    while (i < lenb) {
+        u8 b = data[i];
+        u32 c, k;
+        if (b < 0x80) { c = b; k = 0; }
+        else if ((b & 0xE0) == 0xC0) { c = b & 0x1F; k = 1; }
+        else if ((b & 0xF0) == 0xE0) { c = b & 0x0F; k = 2; }
+        else if ((b & 0xF8) == 0xF0) { c = b & 0x07; k = 3; }
+        else return false;
+
+        if (i + k >= lenb && k > 0) return false;
+        u32 j;
+        for (j = 1; j <= k; ++j) {
+            if ((data[i + j] & 0xC0) != 0x80) return false;
+            c = (c << 6) | (data[i + j] & 0x3F);
+        }
+
+        // overlong, surrogates, and out of range
+        static const u32 mins[] = { 0, 0x80, 0x800, 0x10000 };
+        if (c < mins[k] || (c >= 0xD800 && c <= 0xDFFF) || c > 0x10FFFF) return false;
+
+        i += k + 1;
+        n++;
+    }
+
+    *lenc = n;
+    return true;
+}
+
+// (internal) thread which flattens and hashes a shared rope, which the caller keeps alive
+static void*
+my_flatten(void* arg) {
+    kstr r = arg;
+    u8* data = KSTR_DATA(r);
+    assert(kstr_hash(r) == kmem_hash(r->lenb, data));
+    return data;
+}
+
 int main(int argc, char** argv) {
     kinit(true);
-    
+
+    // UTF-8 validation and counting
+    usize lenc, rlenc;
+    kstr u = kstr_new(-1, "h\xc3\xa9llo \xe2\x82\xac \xf0\x9f\x98\x80");
+    assert(u != NULL && u->lenb == 15 && u->lenc == 9 && !KSTR_ISASCII(u));
+    KOBJ_DECREF(u);
+
+    static const char* bad[] = {
+        "\x80", "\xc0\xaf", "\xe0\x80\xaf", "\xed\xa0\x80", "\xf4\x90\x80\x80",
+        "\xf5\x80\x80\x80", "\xc3", "\xe2\x82", "abc\xff",
+    };
+    usize i, j;
+    for (i = 0; i < sizeof(bad) / sizeof(*bad); ++i) {
+        assert(!kstr_utf8(strlen(bad[i]), (const u8*)bad[i], &lenc));
+    }
+
+    // random inputs of all sizes (so sequences cross blocks), checked against the reference
+    u8 buf[200];
+    u64 rng = 0x12345;
+    for (i = 0; i < 20000; ++i) {
+        usize len = i % sizeof(buf);
+        for (j = 0; j < len; ++j) {
+            rng = rng * 6364136223846793005ull + 1442695040888963407ull;
+            u8 r = rng >> 56;
+            // mostly ASCII and well-formed pieces, with some arbitrary bytes
+            static const u8 pieces[] = { 'a', 0xc3, 0xa9, 0xe2, 0x82, 0xac, 0xf0, 0x9f, 0x98, 0x80, 0xed, 0xef, 0xbf, 0xf4, 0x8f };
+            buf[j] = (r & 0x80) ? pieces[r % sizeof(pieces)] : (r & 0x40 ? 'x' : r);
+        }
+        bool ok = kstr_utf8(len, buf, &lenc), rok = my_ref_utf8(len, buf, &rlenc);
+        assert(ok == rok);
+        if (ok) assert(lenc == rlenc);
+    }
+
     kstr xyz = kstr_new(3, "xyz");
     assert(xyz != NULL);
     assert(xyz->lenb == 3);
-    assert(xyz->lenc == 3);
+    assert(xyz->lenc == 3 && KSTR_ISASCII(xyz));
     assert(strcmp(xyz->data, "xyz") == 0);
     assert(xyz->data[3] == 0x00);
+
+    // equal (but distinct) strings hash the same, and find each other in dictionaries
+    kstr xyz2 = kstr_new(-1, "xyz"), abc = kstr_new(-1, "abc");
+    usize ha, hb;
+    bool eq;
+    assert(xyz2 != xyz);
+    assert(kobj_hash((kobj)xyz, &ha) && kobj_hash((kobj)xyz2, &hb) && ha == hb);
+    assert(kobj_eq((kobj)xyz, (kobj)xyz2, &eq) && eq);
+    assert(kobj_eq((kobj)xyz, (kobj)abc, &eq) && !eq);
+
+    kdict d = kdict_new(NULL);
+    kobj val;
+    assert(kdict_set(d, (kobj)xyz, (kobj)abc));
+    assert(kdict_get(d, (kobj)xyz2, &val) && val == (kobj)abc);
+    KOBJ_DECREF(d);
+
+    // interned strings are the same object
+    kstr ia = kstr_intern(-1, "xyz"), ib = kstr_intern(3, "xyzw");
+    assert(ia != NULL && ia == ib && ia != xyz);
+    assert(KOBJ_ISIMMORTAL(ia));
+    assert(kstr_internz(xyz2) == ia);
+    assert(kstr_intern(-1, "__del") == Ksc_del);
+
+    // long concatenations are ropes, which are flattened when the data is needed
+    char ref[4096];
+    for (i = 0; i < sizeof(ref) - 1; ++i) ref[i] = 'a' + i % 26;
+    ref[sizeof(ref) - 1] = '\0';
+
+    kstr piece = kstr_new(40, ref), r = kstr_new(0, "");
+    for (i = 0; i < 100; ++i) {
+        kstr t = (kstr)kop_add((kobj)r, (kobj)piece);
+        KOBJ_DECREF(r);
+        r = t;
+    }
+    assert(r->lenb == 4000 && r->lenc == 4000 && r->data == NULL);
+    kstr flat = kstr_new(4000, (const char*)KSTR_DATA(r));
+    assert(r->data != NULL && r->data[4000] == '\0');
+    assert(kobj_hash((kobj)r, &ha) && kobj_hash((kobj)flat, &hb) && ha == hb);
+    assert(kobj_eq((kobj)r, (kobj)flat, &eq) && eq);
+    KOBJ_DECREF(flat);
+    KOBJ_DECREF(r);
+
+    // shared ropes are flattened once, even when threads race to do it
+    usize k;
+    for (k = 0; k < 200; ++k) {
+        r = kstr_new(0, "");
+        for (i = 0; i < 100; ++i) {
+            kstr t = kstr_concat(r, piece);
+            KOBJ_DECREF(r);
+            r = t;
+        }
+        pthread_t ths[NTHREADS];
+        for (i = 0; i < NTHREADS; ++i) assert(pthread_create(&ths[i], NULL, my_flatten, r) == 0);
+        void* data[NTHREADS];
+        for (i = 0; i < NTHREADS; ++i) assert(pthread_join(ths[i], &data[i]) == 0);
+        for (i = 0; i < NTHREADS; ++i) assert(data[i] == r->data);
+        for (i = 0; i < 4000; ++i) assert(r->data[i] == ref[i % 40]);
+        KOBJ_DECREF(r);
+    }
+
+    // appending in place, when there are no other references
+    kstr letters[26], s = kstr_new(0, "");
+    for (i = 0; i < 26; ++i) letters[i] = kstr_new(1, ref + i);
+    for (i = 0; i < sizeof(ref) - 1; ++i) {
+        s = (kstr)kop_addz((kobj)s, (kobj)letters[i % 26]);
+    }
+    for (i = 0; i < 26; ++i) KOBJ_DECREF(letters[i]);
+    assert(s->lenb == sizeof(ref) - 1 && memcmp(s->data, ref, s->lenb) == 0 && s->data[s->lenb] == '\0');
+    kstr sref = kstr_new(-1, ref);
+    assert(kobj_hash((kobj)s, &ha) && kobj_hash((kobj)sref, &hb) && ha == hb);
+
+    // but not when there are
+    KOBJ_INCREF(sref);
+    kstr s2 = (kstr)kop_addz((kobj)sref, (kobj)piece);
+    assert(s2 != sref && sref->lenb == sizeof(ref) - 1 && s2->lenb == sref->lenb + 40);
+    KOBJ_DECREF(s2);
+    KOBJ_DECREF(sref);
+    KOBJ_DECREF(s);
+
+    // very deep ropes are freed without recursion
+    r = kstr_new(0, "");
+    for (i = 0; i < 1000000; ++i) {
+        kstr t = kstr_concat(r, piece);
+        KOBJ_DECREF(r);
+        r = t;
+    }
+    assert(r->lenb == 40 * 1000000 && r->data == NULL);
+    KOBJ_DECREF(r);
+    KOBJ_DECREF(piece);
+
+    // building strings in place
+    kstr sb = kstr_builder(4);
+    for (i = 0; i < 1000; ++i) {
+        u8* dst = kstr_reserve(sb, 3);
+        assert(dst != NULL);
+        memcpy(dst, ref + i % 26, 3);
+        kstr_commit(sb, 3);
+    }
+    sb = kstr_seal(sb);
+    assert(sb != NULL && sb->lenb == 3000 && sb->lenc == 3000 && sb->data[3000] == '\0');
+    assert(memcmp(sb->data, "abcbcdcde", 9) == 0);
+    assert(sb->hash == kmem_hash(sb->lenb, sb->data));
+    KOBJ_DECREF(sb);
+
+    sb = kstr_builder(0);
+    kwrite((kobj)sb, 2, "\xc3x");
+    assert(kstr_seal(sb) == NULL);
+
+    // sealed strings (and any other strings) can't be written to
+    sb = kstr_seal(kstr_builder(0));
+    assert(kwrite((kobj)sb, 3, "abc") < 0 && sb->lenb == 0);
+    KOBJ_DECREF(sb);
+    assert(kwrite((kobj)abc, 3, "abc") < 0 && abc->lenb == 3);
+
+    // formatting, which may be longer than the initial size
+    kstr fs = kstr_fmt("%s-%i-%S", ref, 42, abc);
+    assert(fs != NULL && fs->lenb == sizeof(ref) - 1 + 7 && fs->lenc == fs->lenb);
+    assert(memcmp(fs->data + sizeof(ref) - 1, "-42-abc", 8) == 0);
+    kstr fs2 = kstr_fmt("x%iy", 7);
+    assert(fs2->lenb == 3 && strcmp((const char*)fs2->data, "x7y") == 0);
+    assert(fs2->hash == kmem_hash(3, (const u8*)"x7y"));
+    KOBJ_DECREF(fs);
+    KOBJ_DECREF(fs2);
+
+    // taking the data from a buffer, which isn't copied
+    kbuffer bb = kbuffer_new(5, (const u8*)"hello");
+    assert(bb->cap > bb->len);
+    u8* bdata = bb->data;
+    kstr bs = kbuffer_strz(bb);
+    assert(bs != NULL && bs->lenb == 5 && strcmp((const char*)bs->data, "hello") == 0);
+    assert(bs->data == bdata);
+    KOBJ_DECREF(bs);
+
     KOBJ_DECREF(xyz);
+    KOBJ_DECREF(abc);
 
     return 0;
 }